@@ -0,0 +1,45 @@
+/*
+ * Adaptive Debounce - see adaptive_debounce.h
+ */
+
+#include "adaptive_debounce.h"
+
+#define DEBOUNCE_GUARD_US 500   // Added to the bounce margin for timestamp jitter
+
+AdaptiveDebounce::AdaptiveDebounce(uint32_t initialUs, uint32_t floorUs, uint32_t ceilingUs, uint32_t minWidthUs)
+  : window_(initialUs), floor_(floorUs), ceiling_(ceilingUs), minWidth_(minWidthUs) {
+}
+
+// Bounce got through the window - widen at once
+void AdaptiveDebounce::leaked(uint32_t sinceUs) {
+  leaks_++;
+  if (sinceUs > digitBounce_) {
+    digitBounce_ = sinceUs;
+  }
+  window_ = (window_ * 2 < ceiling_) ? window_ * 2 : ceiling_;
+}
+
+void AdaptiveDebounce::update() {
+  // Decay old evidence slowly so one clean digit doesn't undo a noisy one
+  uint32_t decayed = bounceEstimate_ - bounceEstimate_ / 8;
+  bounceEstimate_ = (digitBounce_ > decayed) ? digitBounce_ : decayed;
+  
+  if (digitWidth_) {
+    uint32_t grown = shortestWidth_ + shortestWidth_ / 8;
+    shortestWidth_ = (shortestWidth_ == 0 || digitWidth_ < grown) ? digitWidth_ : grown;
+  }
+  digitBounce_ = 0;
+  digitWidth_ = 0;
+  
+  uint32_t target = bounceEstimate_ + bounceEstimate_ / 2 + DEBOUNCE_GUARD_US;
+  if (shortestWidth_ && target > shortestWidth_ * 3 / 4) {
+    target = shortestWidth_ * 3 / 4;   // Never swallow a real make or break
+  }
+  if (target < floor_) {
+    target = floor_;
+  }
+  if (target > ceiling_) {
+    target = ceiling_;
+  }
+  window_ = target;
+}
@@ -0,0 +1,64 @@
+/*
+ * Adaptive Debounce
+ *
+ * Debounce window for one contact that tunes itself to the dial it is
+ * connected to. Every edge rejected inside the window is a bounce sample
+ * (its distance from the accepted edge); every accepted edge gives a
+ * contact width. After each digit the window moves toward 1.5x the
+ * largest recent bounce, but stays below the shortest real width and
+ * within a fixed floor and ceiling.
+ *
+ * If bounce ever leaks through (an accepted width shorter than any real
+ * pulse could be), the window doubles immediately rather than waiting for
+ * the end of the digit.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class AdaptiveDebounce {
+public:
+  AdaptiveDebounce(uint32_t initialUs, uint32_t floorUs, uint32_t ceilingUs, uint32_t minWidthUs);
+
+  uint32_t window() const { return window_; }
+
+  // An edge arrived sinceUs after the last accepted edge and was rejected.
+  // Inline with accepted(): both run on every edge, and only note the
+  // sample; the window moves in update() or on a leak.
+  void rejected(uint32_t sinceUs) {
+    if (sinceUs < ceiling_ && sinceUs > digitBounce_) {
+      digitBounce_ = sinceUs;   // Longer ago than the ceiling is not bounce
+    }
+  }
+
+  // An edge was accepted sinceUs after the previous accepted one
+  void accepted(uint32_t sinceUs) {
+    if (sinceUs < minWidth_) {
+      leaked(sinceUs);
+    } else if (sinceUs < digitWidth_ || digitWidth_ == 0) {
+      digitWidth_ = sinceUs;
+    }
+  }
+
+  // Digit finished - fold this digit's samples into the window
+  void update();
+
+  uint32_t bounceEstimate() const { return bounceEstimate_; }
+  uint32_t shortestWidth() const { return shortestWidth_; }
+  uint32_t leaks() const { return leaks_; }
+
+private:
+  void leaked(uint32_t sinceUs);
+
+  uint32_t window_;
+  uint32_t floor_;
+  uint32_t ceiling_;
+  uint32_t minWidth_;             // Accepted widths below this are leaked bounce
+
+  uint32_t digitBounce_ = 0;      // Largest bounce seen in the current digit
+  uint32_t digitWidth_ = 0;       // Shortest accepted width in the current digit
+  uint32_t bounceEstimate_ = 0;   // Decaying maximum of digitBounce_
+  uint32_t shortestWidth_ = 0;    // Decaying minimum of digitWidth_
+  uint32_t leaks_ = 0;
+};
@@ -0,0 +1,38 @@
+/*
+ * Bus Capture
+ *
+ * Samples up to 16 dial lines as one parallel bus at a fixed rate, by DMA,
+ * into a ring of DIAL_BUS_BUFFERS buffers (dial_config.h). No interrupt
+ * fires per edge: the peripheral raises one per filled buffer, and the
+ * consumer hands each buffer to DialBank::sampleBlock() in bulk, so CPU
+ * cost follows time rather than edge count.
+ *
+ * Bus bit n is pins[n]. DialBank::sampleBlock<uint16_t>() expects pulse
+ * contacts on bits 0-7 and shunt contacts on bits 8-15: eight dials.
+ *
+ * The ESP32-S3 build uses the LCD_CAM camera interface clocked by LEDC
+ * (bus_capture_lcdcam.cpp). Other targets, and the native build, have no
+ * implementation; there the decode kernel is exercised by bank-bench.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dial_config.h"
+
+#define BUS_CAPTURE_WIDTH 16
+
+// Start sampling pins[0..15] at DIAL_BUS_SAMPLE_HZ. clockPin is a free
+// GPIO that carries the sample clock (it is driven, so leave it
+// unconnected). The calling task must have called halBindConsumer():
+// it is woken for every filled buffer. Returns false if unsupported.
+bool busCaptureBegin(const uint8_t pins[BUS_CAPTURE_WIDTH], uint8_t clockPin);
+
+// Next filled buffer, or nullptr when none is waiting. The samples stay
+// valid until the DMA comes back round to the buffer, which is
+// (DIAL_BUS_BUFFERS - 1) buffer times after it was filled.
+const uint16_t* busCaptureTake();
+
+// Buffers the consumer took too late to be sure of their contents
+uint32_t busCaptureOverruns();
@@ -0,0 +1,139 @@
+/*
+ * Bus Capture - ESP32-S3 LCD_CAM implementation
+ *
+ * The camera interface latches its 16 data inputs on every rising edge of
+ * PCLK and streams them into memory through a GDMA channel. PCLK comes
+ * from an LEDC channel at DIAL_BUS_SAMPLE_HZ, looped back through the GPIO
+ * matrix; VSYNC, HSYNC and DE are tied active, so capture never stops.
+ * cam_rec_data_bytelen ends a DMA transfer at every buffer boundary, and
+ * the GDMA end-of-frame callback queues the finished buffer for the
+ * consumer.
+ */
+
+#include "bus_capture.h"
+#include "edge_ring.h"
+#include "hal.h"
+
+#if CONFIG_IDF_TARGET_ESP32S3
+
+#include <driver/periph_ctrl.h>
+#include <driver/gpio.h>
+#include <esp_private/gdma.h>
+#include <rom/lldesc.h>
+#include <soc/gpio_sig_map.h>
+#include <soc/lcd_cam_struct.h>
+
+#define BUS_BUFFER_BYTES (DIAL_BUS_BUFFER_SAMPLES * sizeof(uint16_t))
+#define BUS_CLOCK_LEDC_CHANNEL 7
+#define BUS_CONST_HIGH 0x38   // GPIO matrix input that always reads 1
+
+static_assert(DIAL_BUS_BUFFERS >= 2 && (DIAL_BUS_BUFFERS & (DIAL_BUS_BUFFERS - 1)) == 0,
+              "Bus buffer count must be a power of two");
+
+static DRAM_ATTR uint16_t busBuffers[DIAL_BUS_BUFFERS][DIAL_BUS_BUFFER_SAMPLES] __attribute__((aligned(4)));
+static DRAM_ATTR lldesc_t busDescriptors[DIAL_BUS_BUFFERS];
+static gdma_channel_handle_t busChannel = nullptr;
+static SpscRing<uint8_t, DIAL_BUS_BUFFERS> filledBuffers;
+
+// Buffers queued behind the one the DMA is filling now, checked in take()
+static uint32_t overruns = 0;
+
+static bool IRAM_ATTR onBufferFilled(gdma_channel_handle_t, gdma_event_data_t* event, void*) {
+  const lldesc_t* done = (const lldesc_t*)event->rx_eof_desc_addr;
+  uint8_t index = (uint8_t)(done - busDescriptors);
+  filledBuffers.push(index);   // A full ring means the consumer fell behind; the drop is counted
+  halNotifyFromIsr();
+  return false;
+}
+
+bool busCaptureBegin(const uint8_t pins[BUS_CAPTURE_WIDTH], uint8_t clockPin) {
+  // Sample clock: 50% duty square wave on clockPin, read back as PCLK
+  ledcSetup(BUS_CLOCK_LEDC_CHANNEL, DIAL_BUS_SAMPLE_HZ, 8);
+  ledcAttachPin(clockPin, BUS_CLOCK_LEDC_CHANNEL);
+  ledcWrite(BUS_CLOCK_LEDC_CHANNEL, 128);
+  gpio_set_direction((gpio_num_t)clockPin, GPIO_MODE_INPUT_OUTPUT);
+  gpio_matrix_in(clockPin, CAM_PCLK_IDX, false);
+  gpio_matrix_in(BUS_CONST_HIGH, CAM_V_SYNC_IDX, false);
+  gpio_matrix_in(BUS_CONST_HIGH, CAM_H_SYNC_IDX, false);
+  gpio_matrix_in(BUS_CONST_HIGH, CAM_H_ENABLE_IDX, false);
+  for (int bit = 0; bit < BUS_CAPTURE_WIDTH; bit++) {
+    pinMode(pins[bit], INPUT_PULLUP);
+    gpio_matrix_in(pins[bit], CAM_DATA_IN0_IDX + bit, false);
+  }
+  
+  // Circular descriptor chain, one descriptor per buffer
+  for (int i = 0; i < DIAL_BUS_BUFFERS; i++) {
+    lldesc_t& descriptor = busDescriptors[i];
+    descriptor.size = BUS_BUFFER_BYTES;
+    descriptor.length = 0;
+    descriptor.offset = 0;
+    descriptor.sosf = 0;
+    descriptor.eof = 0;
+    descriptor.owner = 1;
+    descriptor.buf = (uint8_t*)busBuffers[i];
+    descriptor.qe.stqe_next = &busDescriptors[(i + 1) % DIAL_BUS_BUFFERS];
+  }
+  
+  periph_module_enable(PERIPH_LCD_CAM_MODULE);
+  LCD_CAM.cam_ctrl.val = 0;
+  LCD_CAM.cam_ctrl.cam_clk_sel = 3;         // Core clock from PLL_F160M
+  LCD_CAM.cam_ctrl.cam_clkm_div_num = 2;
+  LCD_CAM.cam_ctrl.cam_stop_en = 0;         // Keep going if the DMA lags
+  LCD_CAM.cam_ctrl.cam_vs_eof_en = 0;       // End transfers on the byte count below
+  LCD_CAM.cam_ctrl1.val = 0;
+  LCD_CAM.cam_ctrl1.cam_rec_data_bytelen = BUS_BUFFER_BYTES - 1;
+  LCD_CAM.cam_ctrl1.cam_2byte_en = 1;       // 16-bit bus
+  LCD_CAM.cam_rgb_yuv.val = 0;
+  LCD_CAM.cam_ctrl.cam_update = 1;
+  LCD_CAM.cam_ctrl1.cam_reset = 1;
+  LCD_CAM.cam_ctrl1.cam_reset = 0;
+  LCD_CAM.cam_ctrl1.cam_afifo_reset = 1;
+  LCD_CAM.cam_ctrl1.cam_afifo_reset = 0;
+  
+  gdma_channel_alloc_config_t channelConfig = {};
+  channelConfig.direction = GDMA_CHANNEL_DIRECTION_RX;
+  if (gdma_new_channel(&channelConfig, &busChannel) != ESP_OK) {
+    return false;
+  }
+  gdma_connect(busChannel, GDMA_MAKE_TRIGGER(GDMA_TRIG_PERIPH_CAM, 0));
+  gdma_rx_event_callbacks_t callbacks = {};
+  callbacks.on_recv_eof = onBufferFilled;
+  gdma_register_rx_event_callbacks(busChannel, &callbacks, nullptr);
+  gdma_start(busChannel, (intptr_t)&busDescriptors[0]);
+  
+  LCD_CAM.cam_ctrl1.cam_start = 1;
+  return true;
+}
+
+const uint16_t* busCaptureTake() {
+  uint8_t index;
+  if (!filledBuffers.pop(index)) {
+    return nullptr;
+  }
+  // More buffers still queued behind this one than the DMA leaves alone
+  // means it has already been overwritten at least in part
+  if (filledBuffers.size() >= DIAL_BUS_BUFFERS - 1) {
+    overruns++;
+  }
+  return busBuffers[index];
+}
+
+uint32_t busCaptureOverruns() {
+  return overruns + filledBuffers.dropped();
+}
+
+#else
+
+bool busCaptureBegin(const uint8_t*, uint8_t) {
+  return false;   // Only the S3 has the LCD_CAM interface
+}
+
+const uint16_t* busCaptureTake() {
+  return nullptr;
+}
+
+uint32_t busCaptureOverruns() {
+  return 0;
+}
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * Dial Bank - see dial_bank.h
+ */
+
+#include "dial_bank.h"
+#include <string.h>
+
+DialBank::DialBank()
+  : pulse_(0),              // Pulse contacts are closed (LOW) at rest
+    shunt_(0xFFFFFFFF) {    // Shunt contacts are HIGH at rest
+  for (int i = 0; i < 4; i++) {
+    count_[i] = 0;
+  }
+}
+
+uint32_t DialBank::sample(uint32_t pulseWord, uint32_t shuntWord) {
+  uint32_t shuntChanges = shunt_.update(shuntWord);
+  uint32_t shuntState = shunt_.state();
+  uint32_t started = shuntChanges & ~shuntState;   // Shunt fell - dial off-normal
+  uint32_t rested = shuntChanges & shuntState;     // Shunt rose - dial back at rest
+  
+  // Clear the counters of lines that just started dialing
+  for (int i = 0; i < 4; i++) {
+    count_[i] &= ~started;
+  }
+  
+  // Count on HIGH transitions of the pulse contact while off-normal
+  uint32_t pulseChanges = pulse_.update(pulseWord);
+  uint32_t carry = pulseChanges & pulse_.state() & ~shuntState;
+  for (int i = 0; i < 4; i++) {
+    uint32_t next = count_[i] & carry;
+    count_[i] ^= carry;
+    carry = next;
+  }
+  
+  uint32_t counted = count_[0] | count_[1] | count_[2] | count_[3];
+  return rested & counted;
+}
+
+int DialBank::pulses(int line) const {
+  int count = 0;
+  for (int i = 0; i < 4; i++) {
+    count |= ((count_[i] >> line) & 1) << i;
+  }
+  return count;
+}
+
+// First index from i on whose sample differs from value. Idle lines make
+// long runs of one sample, so compare a machine word of samples at a time.
+template <typename Sample>
+static size_t skipRepeats(const Sample* samples, size_t i, size_t count, Sample value) {
+  const size_t perWord = sizeof(size_t) / sizeof(Sample);
+  size_t pattern = 0;
+  for (size_t k = 0; k < perWord; k++) {
+    pattern |= (size_t)value << (k * 8 * sizeof(Sample));
+  }
+  while (i + perWord <= count) {
+    size_t word;
+    memcpy(&word, samples + i, sizeof(word));
+    if (word != pattern) {
+      break;
+    }
+    i += perWord;
+  }
+  while (i < count && samples[i] == value) {
+    i++;
+  }
+  return i;
+}
+
+template <typename Sample>
+size_t DialBank::sampleBlock(const Sample* samples, size_t count, DialBankHandler handler, void* context) {
+  const int lines = sizeof(Sample) * 4;
+  const uint32_t lineMask = (uint32_t)((1ULL << lines) - 1);
+  size_t digits = 0;
+  
+  size_t i = 0;
+  while (i < count) {
+    Sample value = samples[i++];
+    uint32_t pulseWord = value & lineMask;
+    uint32_t shuntWord = (uint32_t)(value >> lines) | ~lineMask;   // Lines beyond the bus stay idle
+    uint32_t completed = sample(pulseWord, shuntWord);
+    while (completed) {
+      int line = __builtin_ctz(completed);
+      completed &= completed - 1;
+      handler(line, pulses(line), context);
+      digits++;
+    }
+    
+    // With both debouncers settled on this sample, feeding it again
+    // changes nothing: no counter runs and no state flips
+    if (pulseWord == pulse_.state() && shuntWord == shunt_.state()) {
+      i = skipRepeats(samples, i, count, value);
+    }
+  }
+  return digits;
+}
+
+template size_t DialBank::sampleBlock<uint16_t>(const uint16_t*, size_t, DialBankHandler, void*);
+template size_t DialBank::sampleBlock<uint32_t>(const uint32_t*, size_t, DialBankHandler, void*);
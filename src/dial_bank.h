@@ -0,0 +1,80 @@
+/*
+ * Dial Bank
+ *
+ * Decodes up to 32 dials at once from periodic samples of two input words
+ * (one bit per dial for the pulse contacts, one for the shunt contacts),
+ * e.g. a GPIO input register or an I/O expander read from a timer.
+ *
+ * Everything is bit-sliced: each bit position is one line, debouncing uses
+ * vertical counters, and pulse counts are kept as four bit planes that
+ * are incremented for all lines with one short sequence of word
+ * operations. The cost of a sample is the same for 1 line or 32; only
+ * completed digits are handled one line at a time.
+ *
+ * sampleBlock() takes whole buffers of parallel bus samples instead (see
+ * bus_capture.h), so a DMA-sampled bus costs CPU time per buffer rather
+ * than an interrupt per edge.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DIAL_BANK_LINES 32
+
+// Completed digit reported by DialBank::sampleBlock()
+typedef void (*DialBankHandler)(int line, int pulses, void* context);
+
+// Two-bit vertical counter debouncer: a line's state changes only after
+// its sample has disagreed with the state for 4 consecutive samples.
+class VerticalDebouncer {
+public:
+  explicit VerticalDebouncer(uint32_t initial = 0xFFFFFFFF) : state_(initial) {}
+
+  // Feed one sample word; returns the mask of lines that changed state
+  inline uint32_t update(uint32_t sample) {
+    uint32_t delta = sample ^ state_;
+    count1_ = (count1_ ^ count0_) & delta;
+    count0_ = ~count0_ & delta;
+    uint32_t changes = delta & ~(count0_ | count1_);
+    state_ ^= changes;
+    return changes;
+  }
+
+  uint32_t state() const { return state_; }
+
+private:
+  uint32_t state_;
+  uint32_t count0_ = 0;   // Low bit plane of the per-line counters
+  uint32_t count1_ = 0;   // High bit plane
+};
+
+class DialBank {
+public:
+  DialBank();
+
+  // Feed one sample of all pulse and shunt lines. Returns the mask of
+  // lines whose dial returned to rest with at least one pulse counted.
+  uint32_t sample(uint32_t pulseWord, uint32_t shuntWord);
+
+  // Feed a buffer of bus samples, each holding the pulse contacts in its
+  // low half and the shunt contacts in its high half (uint16_t: lines 0-7,
+  // uint32_t: lines 0-15). Calls handler for every completed digit and
+  // returns how many there were. Once the debouncers agree with the bus,
+  // repeats of the same sample are skipped a machine word at a time.
+  template <typename Sample>
+  size_t sampleBlock(const Sample* samples, size_t count, DialBankHandler handler, void* context);
+
+  // Pulse count of a line (valid after its completion bit was returned
+  // and until its next dial start)
+  int pulses(int line) const;
+
+  // Lines currently off-normal (shunt LOW)
+  uint32_t dialing() const { return ~shunt_.state(); }
+
+private:
+  VerticalDebouncer pulse_;
+  VerticalDebouncer shunt_;
+  uint32_t count_[4];     // Bit-sliced 4-bit pulse counters
+};
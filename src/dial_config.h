@@ -0,0 +1,140 @@
+/*
+ * Dial Configuration
+ *
+ * Pin assignments and timing constants shared by the firmware and the
+ * native host build.
+ */
+
+#pragma once
+
+// Pin definitions (same as RetroBell project)
+#define ROTARY_PULSE_PIN 15   // Pulse switch (counts rotations)
+#define ROTARY_SHUNT_PIN 14   // Shunt/off-normal switch (active while dialing)
+
+// Timing exported by "program tune" overrides the defaults marked "tuned"
+#if __has_include("dial_tuning.h")
+#include "dial_tuning.h"
+#endif
+
+// Timing constants, in microseconds (edges are timestamped with halMicros())
+#ifndef PULSE_DEBOUNCE_US
+#define PULSE_DEBOUNCE_US 15000      // Debounce time for pulse switch (fits 20 pps dials) - tuned
+#endif
+#ifndef DIAL_DEBOUNCE_US
+#define DIAL_DEBOUNCE_US 50000       // Debounce time for dial switch - tuned
+#endif
+#ifndef DIAL_TIMEOUT_US
+#define DIAL_TIMEOUT_US 1500000      // Time after last pulse to consider dialing complete - tuned
+#endif
+#define DIAL_SAFETY_TIMEOUT_US (DIAL_TIMEOUT_US * 2)  // 3 seconds as backup (upper bound) if the shunt never closes
+
+// Adaptive debounce: the windows above are starting points, tuned per dial
+// from observed bounce within these bounds (set to 0 for fixed windows)
+#define DEBOUNCE_ADAPTIVE 1
+#define PULSE_DEBOUNCE_MIN_US 3000   // Safety floor
+#define PULSE_DEBOUNCE_MAX_US 25000  // Safety ceiling
+#define PULSE_MIN_WIDTH_US 10000     // Shorter accepted pulse widths are leaked bounce
+#define DIAL_DEBOUNCE_MIN_US 10000
+#define DIAL_DEBOUNCE_MAX_US 50000
+#define DIAL_MIN_WIDTH_US 20000
+
+// Early digit emission: report a provisional digit once the gap since the
+// last pulse clearly exceeds the learned pulse period, before the shunt
+// closes. The shunt edge then confirms or corrects it.
+#define DIAL_EARLY_DIGIT 0           // 1 = enable predictive completion
+#define EARLY_GAP_PERCENT 125        // Gap (percent of learned period) that ends a digit
+
+// Deferred settle sampling: instead of trusting the level read at the first
+// edge, an edge only (re)starts a one-shot settle timer. Once the lines have
+// been quiet for SETTLE_US they are sampled SETTLE_SAMPLES times and the
+// majority level is queued, timestamped with the first edge of the burst.
+#define DIAL_SETTLE_SAMPLING 0       // 1 = enable
+#define SETTLE_US 2000               // Quiet time after the last raw edge
+#define SETTLE_SAMPLES 3             // Samples per vote (odd)
+#define SETTLE_SAMPLE_SPACING_US 200
+
+// Pulse counting backend. DIAL_COUNTER_ISR decodes every pulse edge from
+// interrupts. DIAL_COUNTER_PCNT counts breaks in the pulse counter
+// peripheral and only interrupts on the shunt: no per-pulse events, period
+// learning, confidence or pulse-only mode, and the pulse line needs
+// hardware debouncing since the PCNT filter only reaches PCNT_FILTER_NS.
+// DIAL_COUNTER_RMT records the pulse line's level durations in the RMT
+// receiver and decodes each frame once the line has been idle for
+// PULSE_CAPTURE_IDLE_US: exact timing and one interrupt per digit, but
+// every pulse event arrives that much later (see pulse_capture.h).
+#define DIAL_COUNTER_ISR 0
+#define DIAL_COUNTER_PCNT 1
+#define DIAL_COUNTER_RMT 2
+#define DIAL_COUNTER DIAL_COUNTER_ISR
+#define PCNT_FILTER_NS 12787         // 1023 APB cycles, the hardware maximum
+#define PULSE_CAPTURE_IDLE_US 95000  // Longer than any break or make (7 pps), below the 98 ms RMT limit
+#define PULSE_CAPTURE_MARGIN_US 5000 // Allowance for the capture task to deliver a frame
+#define PULSE_CAPTURE_MIN_US 5000    // Shorter levels in a frame are bounce
+
+// Parallel bus capture (bus_capture.h): the dial lines of a DialBank are
+// DMA-sampled as one 16-bit word at DIAL_BUS_SAMPLE_HZ, DIAL_BUS_BUFFER_SAMPLES
+// per buffer. The consumer must take each buffer before the DMA wraps
+// around the other DIAL_BUS_BUFFERS - 1.
+#define DIAL_BUS_SAMPLE_HZ 1000      // 1 ms samples, as the DialBank debouncers expect
+#define DIAL_BUS_BUFFER_SAMPLES 64   // One wakeup per 64 ms
+#define DIAL_BUS_BUFFERS 4
+#define DIAL_BUS_CAPTURE 0           // 1 = also decode eight switchboard dials from the bus (S3 only)
+#define DIAL_BUS_PINS { 1, 2, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 16, 17, 18, 21 }   // Pulses 0-7, shunts 8-15
+#define DIAL_BUS_CLOCK_PIN 47        // Sample clock output, leave unconnected
+
+// Event output (main.cpp): readable text, or binary telemetry frames for a
+// supervising host (telemetry.h). The 't' key switches at runtime. Binary
+// output sends only the events in DIAL_TELEMETRY_EVENTS (bit per
+// DIAL_EVENT_*): by default one frame per digit.
+#define DIAL_TELEMETRY_TEXT 0
+#define DIAL_TELEMETRY_BINARY 1
+#define DIAL_TELEMETRY DIAL_TELEMETRY_TEXT
+#define DIAL_TELEMETRY_EVENTS ((1 << DIAL_EVENT_RESTED) | (1 << DIAL_EVENT_TIMEOUT) | (1 << DIAL_EVENT_PROVISIONAL))
+
+// Deferred log (dial_log.h): records above this level are dropped where
+// they are logged. DIAL_LOG_DEBUG adds one record per raw edge.
+#define DIAL_LOG_LEVEL 2             // DIAL_LOG_INFO
+
+// Raw edge trace (edge_trace.h), 2-3 bytes per edge. Dump with the 'd' key.
+#define EDGE_TRACE 1
+#define EDGE_TRACE_PSRAM_BYTES (2 * 1024 * 1024)
+#define EDGE_TRACE_RAM_BYTES (32 * 1024)  // Internal RAM without PSRAM
+#define EDGE_TRACE_BLOCK_BYTES 256        // Keyframe interval, and what the ring drops at a time
+#define EDGE_TRACE_STAGE_SIZE 512         // Raw edges held in internal RAM until loop() encodes them (a full RMT frame fits)
+
+// Pulse period learning (used by early digits and the adaptive timeout)
+#define PULSE_PERIOD_MIN_US 30000    // Plausible pulse periods (fast 20 pps .. slow 7 pps)
+#define PULSE_PERIOD_MAX_US 150000
+
+// Adaptive completion timeout: once a digit has pulses, give up on the
+// shunt after a few learned pulse periods (or 1.5x the usual last-pulse to
+// shunt lag, if longer) instead of the full safety timeout
+#define DIAL_TIMEOUT_ADAPTIVE 1
+#ifndef DIAL_TIMEOUT_PERIODS
+#define DIAL_TIMEOUT_PERIODS 2       // Pulse periods of silence that end a digit - tuned
+#endif
+#ifndef DIAL_TIMEOUT_MIN_US
+#define DIAL_TIMEOUT_MIN_US 100000   // Never shorter than this - tuned
+#endif
+
+// Shunt (off-normal) contact: wired, absent (pulse-only - the first pulse
+// opens a digit and a pulse gap of DIAL_TIMEOUT_PERIODS ends it), or
+// detected at runtime. AUTO starts pulse-only, switches to the shunt as
+// soon as it opens at rest, and falls back to pulse-only if pulse trains
+// keep arriving while the shunt stays silent.
+#define DIAL_SHUNT_WIRED 0
+#define DIAL_SHUNT_ABSENT 1
+#define DIAL_SHUNT_AUTO 2
+#define DIAL_SHUNT_MODE DIAL_SHUNT_AUTO
+#define DIAL_SHUNT_LOST_PULSES 3     // Pulses at rest in one train, with no shunt activity, that mean no shunt
+
+// Digit confidence: cross-check each pulse count against the regularity of
+// its pulse intervals and, with a shunt, against the time from the first
+// pulse to the shunt closing. Digits scoring below DIAL_CONFIDENCE_MIN are
+// flagged DIAL_FLAG_SUSPECT. With DIAL_CONFIDENCE_REPAIR, a count that the
+// intervals show is off by a missed or split pulse is corrected.
+#define DIAL_CONFIDENCE_MIN 60       // 0-100
+#define DIAL_CONFIDENCE_REPAIR 1
+
+// Edge ring between the ISRs and loop()
+#define EDGE_RING_SIZE 256           // Raw edges buffered between loop() passes
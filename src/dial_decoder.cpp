@@ -0,0 +1,359 @@
+/*
+ * Dial Decoder - see dial_decoder.h
+ */
+
+#include "dial_decoder.h"
+#include "dial_config.h"
+
+// The table for this wiring is fixed at compile time; spot-check it
+static_assert(DialDecoder::table.entry[DIAL_STATE_IDLE][DIAL_INPUT_SHUNT_OPEN].next == DIAL_STATE_OFF_NORMAL,
+              "Shunt opening must start a digit");
+static_assert(DialDecoder::table.entry[DIAL_STATE_PULSE_MAKE][DIAL_INPUT_PULSE_BREAK].event == DIAL_EVENT_PULSE,
+              "Pulse contact opening must count a pulse");
+static_assert(DialDecoder::table.entry[DIAL_STATE_IDLE][DIAL_INPUT_PULSE_BREAK].event == DIAL_EVENT_NONE,
+              "Pulses at rest must be ignored");
+static_assert(DialDecoder::pulseOnlyTable.entry[DIAL_STATE_IDLE][DIAL_INPUT_PULSE_BREAK].event == DIAL_EVENT_PULSE,
+              "Without a shunt, the first pulse must start a digit");
+static_assert(DialDecoder::pulseOnlyTable.entry[DIAL_STATE_PULSE_MAKE][DIAL_INPUT_TIMEOUT].event == DIAL_EVENT_RESTED,
+              "Without a shunt, a pulse gap must end the digit");
+
+template <typename Dial>
+DialEvent BasicDialDecoder<Dial>::step(DialInput input, uint64_t now) {
+  const DialTransition& t = (pulseOnly_ ? pulseOnlyTable : table).entry[state_][input];
+  uint8_t previous = state_;
+  state_ = t.next;
+  
+  if (t.actions & DIAL_ACTION_RESET) {
+    pulseCount_ = 0;
+    provisionalPulses_ = 0;
+    intervalCount_ = 0;
+  }
+  if (t.actions & DIAL_ACTION_COUNT) {
+    // Learn the dial's pulse period from consecutive pulses of one digit
+    if (pulseCount_ > 0) {
+      uint64_t interval = now - lastPulseTime_;
+      if (interval >= PULSE_PERIOD_MIN_US && interval <= PULSE_PERIOD_MAX_US) {
+        periodUs_ = periodUs_ ? (uint32_t)((periodUs_ * 3ull + interval) / 4) : (uint32_t)interval;
+      }
+      if (intervalCount_ < MAX_INTERVALS) {
+        intervals_[intervalCount_++] = interval > 0xFFFFFFFFull ? 0xFFFFFFFF : (uint32_t)interval;
+      }
+    } else {
+      firstPulseTime_ = now;
+    }
+    pulseCount_++;
+    lastPulseTime_ = now;
+  }
+  if (t.actions & DIAL_ACTION_ARM) {
+    dialingTimeout_ = now;  // Reset timeout on each pulse
+  }
+  if (t.event == DIAL_EVENT_RESTED || t.event == DIAL_EVENT_TIMEOUT) {
+    pulseDebounce_.update();
+    dialDebounce_.update();
+  }
+  bool shuntClosed = t.event == DIAL_EVENT_RESTED || previous == DIAL_STATE_FAULT;
+  if (input == DIAL_INPUT_SHUNT_CLOSE && shuntClosed && pulseCount_ > 0) {
+    // Learn how long this dial's shunt lags the last pulse (decaying max),
+    // including shunts that closed only after the timeout gave up on them
+    uint64_t lag = now - lastPulseTime_;
+    uint32_t decayed = restLagUs_ - restLagUs_ / 32;
+    restLagUs_ = (lag > decayed) ? (lag > safetyTimeoutUs_ ? safetyTimeoutUs_ : (uint32_t)lag) : decayed;
+  }
+  
+  DialEvent event = { t.event, (uint8_t)pulseCount_, now, 0, 0, 100 };
+  
+  bool digitDone = t.event == DIAL_EVENT_RESTED || t.event == DIAL_EVENT_TIMEOUT;
+  if ((digitDone || t.event == DIAL_EVENT_PROVISIONAL) && pulseCount_ > 0) {
+    assess(event, input == DIAL_INPUT_SHUNT_CLOSE);
+  }
+  
+  if (input == DIAL_INPUT_SHUNT_CLOSE && t.event == DIAL_EVENT_RESTED && pulseCount_ > 0) {
+    // Typical shunt lag, for the next digit's cross-check
+    uint32_t lag = (uint32_t)(now - lastPulseTime_);
+    if (lag < safetyTimeoutUs_) {
+      uint32_t deviation = lag > lagAvgUs_ ? lag - lagAvgUs_ : lagAvgUs_ - lag;
+      lagDevUs_ = lagAvgUs_ ? (lagDevUs_ * 7 + deviation) / 8 : 0;
+      lagAvgUs_ = lagAvgUs_ ? (lagAvgUs_ * 7 + lag) / 8 : lag;
+    }
+  }
+  
+  if (t.event == DIAL_EVENT_PROVISIONAL) {
+    provisionalPulses_ = event.pulses;
+  } else if (digitDone && provisionalPulses_) {
+    event.flags |= (provisionalPulses_ == event.pulses) ? DIAL_FLAG_CONFIRMED : DIAL_FLAG_CORRECTED;
+  }
+  return event;
+}
+
+template <typename Dial>
+void BasicDialDecoder<Dial>::assess(DialEvent& event, bool shuntClosed) const {
+  // Reference period: the median of this digit's intervals when it has a
+  // few (one bad interval cannot skew it), else the learned period
+  uint32_t period = periodUs_;
+  bool ownPeriod = intervalCount_ >= 3;
+  if (ownPeriod) {
+    // The interval with intervalCount_ / 2 others ranked below it (ties
+    // broken by position). Counting ranks has no data-dependent branches,
+    // unlike sorting nearly equal values.
+    int middle = intervalCount_ / 2;
+    for (int i = 0; i < intervalCount_; i++) {
+      int rank = 0;
+      for (int j = 0; j < intervalCount_; j++) {
+        rank += (intervals_[j] < intervals_[i]) | ((intervals_[j] == intervals_[i]) & (j < i));
+      }
+      if (rank == middle) {
+        period = intervals_[i];
+      }
+    }
+  }
+  if (period == 0) {
+    return;   // Single pulse on a dial we know nothing about yet
+  }
+  
+  // Interval regularity: about two periods means a pulse went missing,
+  // a fraction of one means a pulse was split by a bounce that got through.
+  // A learned period may be from a digit dialed faster or slower, so it
+  // only supports the gross checks.
+  int score = 100;
+  int missed = 0, split = 0;
+  bool clean = true;   // Every anomaly is an unambiguous multiple or fraction
+  uint32_t worstDeviation = 0;
+  for (int i = 0; i < intervalCount_; i++) {
+    // Clamped to 4 s so the permille product stays in 32 bits - 64-bit
+    // division is a library call on the ESP32
+    uint32_t interval = intervals_[i] < 4000000u ? intervals_[i] : 4000000u;
+    uint32_t ratio = interval * 1000 / period;   // Permille
+    if (ratio >= (ownPeriod ? 1600u : 1750u)) {
+      int periods = (int)((ratio + 500) / 1000);
+      missed += periods - 1;
+      score -= 35 * (periods - 1);
+      uint32_t offset = ratio > periods * 1000u ? ratio - periods * 1000u : periods * 1000u - ratio;
+      clean = clean && offset <= 250;
+    } else if (ratio < 600) {
+      split++;
+      score -= 35;
+      clean = clean && ratio < 400;
+    } else if (ownPeriod) {
+      uint32_t deviation = ratio > 1000 ? ratio - 1000 : 1000 - ratio;
+      worstDeviation = deviation > worstDeviation ? deviation : worstDeviation;
+    }
+  }
+  score -= worstDeviation / 20;   // 25% off costs 12
+  int estimate = event.pulses + missed - split;
+  
+  // Shunt cross-check: first pulse to shunt close should be whole periods
+  // plus the dial's usual lag. A missed first or last pulse only shows here.
+  bool shuntChecked = shuntClosed && lagAvgUs_;
+  bool shuntAgrees = false;
+  if (shuntChecked) {
+    int64_t span = (int64_t)(event.time - firstPulseTime_) - lagAvgUs_;
+    int64_t tolerance = (ownPeriod ? period / 2 : period) + (int64_t)lagDevUs_;
+    int64_t residual = span - (int64_t)(event.pulses - 1) * period;
+    int64_t repairedResidual = span - (int64_t)(estimate - 1) * period;
+    if (residual < -tolerance || residual > tolerance) {
+      int periodsOff = (int)((residual < 0 ? -residual : residual) + period / 2) / period;
+      score -= 45 * (periodsOff ? periodsOff : 1);
+    }
+    shuntAgrees = repairedResidual >= -tolerance && repairedResidual <= tolerance;
+  }
+  
+  // Only repair against the digit's own period
+  if (DIAL_CONFIDENCE_REPAIR && ownPeriod && estimate != event.pulses && estimate >= 1 && estimate <= 10
+      && (shuntAgrees || (clean && !shuntChecked))) {
+    // Report the count the timing supports; how sure we are depends on
+    // whether the shunt backs the intervals up
+    event.pulses = (uint8_t)estimate;
+    event.flags |= DIAL_FLAG_REPAIRED;
+    score = shuntAgrees ? 75 : 55;
+  }
+  
+  event.confidence = (uint8_t)(score < 0 ? 0 : score);
+  if (event.confidence < DIAL_CONFIDENCE_MIN) {
+    event.flags |= DIAL_FLAG_SUSPECT;
+  }
+}
+
+template <typename Dial>
+uint64_t BasicDialDecoder<Dial>::gapDeadline() const {
+  // Only after a completed make, with a period learned and nothing reported
+  // yet. Pulse-only digits already end on the gap, there is nothing to confirm.
+  if (!earlyDigit_ || pulseOnly_ || state_ != DIAL_STATE_PULSE_MAKE || periodUs_ == 0) {
+    return 0;
+  }
+  return lastPulseTime_ + (uint64_t)periodUs_ * EARLY_GAP_PERCENT / 100;
+}
+
+template <typename Dial>
+DialEvent BasicDialDecoder<Dial>::pulseEdge(uint64_t now, bool currentPulseState) {
+  // Debounce - an edge inside the window, or one that leaves the level
+  // unchanged (its opposite edge was swallowed), is bounce
+  uint64_t since = now - lastPulseDebounce_;
+  uint32_t sinceUs = since > 0xFFFFFFFFull ? 0xFFFFFFFF : (uint32_t)since;
+  if (sinceUs < pulseDebounce_.window() || currentPulseState == lastPulseState_) {
+    pulseDebounce_.rejected(sinceUs);
+    DialEvent none = { DIAL_EVENT_NONE, 0, now, 0, 0, 100 };
+    return none;
+  }
+  
+  pulseDebounce_.accepted(sinceUs);
+  lastPulseDebounce_ = now;
+  lastPulseState_ = currentPulseState;
+  
+  DialInput input = currentPulseState ? DIAL_INPUT_PULSE_BREAK : DIAL_INPUT_PULSE_MAKE;
+  if (input == Dial::countInput && !isDialingState(state_) && shuntLost(now)) {
+    // Now pulse-only: this pulse opens a digit that includes the rest of its train
+    DialEvent event = step(input, now);
+    pulseCount_ = restTrain_;
+    event.pulses = restTrain_;
+    return event;
+  }
+  return step(input, now);
+}
+
+template <typename Dial>
+bool BasicDialDecoder<Dial>::shuntLost(uint64_t now) {
+  // Counted pulses at rest mean the shunt did not open for them
+  bool resting = state_ == DIAL_STATE_IDLE || state_ == DIAL_STATE_COMPLETE;
+  if (shuntMode_ != DIAL_SHUNT_AUTO || pulseOnly_ || !resting) {
+    return false;
+  }
+  
+  // The pulses must come in one train: strays hours apart are noise
+  if (now - lastRestPulse_ > (uint64_t)PULSE_PERIOD_MAX_US * timing_.timeoutPeriods) {
+    restTrain_ = 0;
+    restPulses_ = 0;
+  }
+  restTrain_++;
+  restPulses_++;
+  lastRestPulse_ = now;
+  if (restPulses_ < DIAL_SHUNT_LOST_PULSES) {
+    return false;
+  }
+  pulseOnly_ = true;
+  restPulses_ = 0;
+  return true;
+}
+
+template <typename Dial>
+DialEvent BasicDialDecoder<Dial>::shuntEdge(uint64_t now, bool currentDialState) {
+  // Debounce
+  uint64_t since = now - lastDialDebounce_;
+  uint32_t sinceUs = since > 0xFFFFFFFFull ? 0xFFFFFFFF : (uint32_t)since;
+  if (sinceUs < dialDebounce_.window() || currentDialState == lastDialState_) {
+    dialDebounce_.rejected(sinceUs);
+    DialEvent none = { DIAL_EVENT_NONE, 0, now, 0, 0, 100 };
+    return none;
+  }
+  
+  dialDebounce_.accepted(sinceUs);
+  lastDialDebounce_ = now;
+  lastDialState_ = currentDialState;
+  
+  // Any shunt activity means one is wired; it opening at rest is the
+  // start of a digit it can track from here on
+  restPulses_ = 0;
+  if (shuntMode_ == DIAL_SHUNT_AUTO && pulseOnly_ && !currentDialState && !isDialing()) {
+    pulseOnly_ = false;
+  }
+  return step(currentDialState ? DIAL_INPUT_SHUNT_CLOSE : DIAL_INPUT_SHUNT_OPEN, now);
+}
+
+template <typename Dial>
+uint32_t BasicDialDecoder<Dial>::completionTimeout() const {
+  // Before the first pulse the finger may still be winding the dial.
+  // Pulse-only digits always end on the gap, there is no shunt to wait for.
+  if ((!DIAL_TIMEOUT_ADAPTIVE && !pulseOnly_) || pulseCount_ == 0) {
+    return safetyTimeoutUs_;
+  }
+  
+  // Until a period is learned, assume the slowest dial we accept
+  uint32_t period = periodUs_ ? periodUs_ : PULSE_PERIOD_MAX_US;
+  uint32_t timeout = period * timing_.timeoutPeriods;
+  uint32_t lagMargin = pulseOnly_ ? 0 : restLagUs_ + restLagUs_ / 2;
+  if (lagMargin > timeout) {
+    timeout = lagMargin;   // Let a working shunt finish first
+  }
+  if (timeout < timing_.timeoutMinUs) {
+    timeout = timing_.timeoutMinUs;
+  }
+  return timeout < safetyTimeoutUs_ ? timeout : safetyTimeoutUs_;
+}
+
+template <typename Dial>
+DialEvent BasicDialDecoder<Dial>::poll(uint64_t now) {
+  // Timeout backup in case the shunt switch fails or is missing
+  if (isDialing() && (now - dialingTimeout_) > completionTimeout()) {
+    return step(DIAL_INPUT_TIMEOUT, now);
+  }
+  
+  uint64_t gap = gapDeadline();
+  if (gap && now >= gap) {
+    return step(DIAL_INPUT_GAP, now);
+  }
+  
+  DialEvent none = { DIAL_EVENT_NONE, 0, now, 0, 0, 100 };
+  return none;
+}
+
+template <typename Dial>
+uint64_t BasicDialDecoder<Dial>::deadline() const {
+  if (!isDialing()) {
+    return 0;
+  }
+  uint64_t safety = dialingTimeout_ + completionTimeout() + 1;
+  uint64_t gap = gapDeadline();
+  return (gap && gap < safety) ? gap : safety;
+}
+
+template <typename Dial>
+void BasicDialDecoder<Dial>::setCountedPulses(int pulses, uint64_t now) {
+  if (isDialing() && pulses != pulseCount_) {
+    pulseCount_ = pulses;
+    lastPulseTime_ = now;
+    dialingTimeout_ = now;
+  }
+}
+
+template <typename Dial>
+void BasicDialDecoder<Dial>::setInitialLevels(bool pulseState, bool dialState) {
+  lastPulseState_ = pulseState;
+  lastDialState_ = dialState;
+}
+
+template <typename Dial>
+void BasicDialDecoder<Dial>::setShuntMode(uint8_t mode) {
+  shuntMode_ = mode;
+  pulseOnly_ = mode != DIAL_SHUNT_WIRED;
+  restPulses_ = 0;
+  restTrain_ = 0;
+}
+
+template <typename Dial>
+void BasicDialDecoder<Dial>::setTiming(const DialTiming& timing) {
+  timing_ = timing;
+  safetyTimeoutUs_ = timing.timeoutUs * 2;   // As DIAL_SAFETY_TIMEOUT_US
+#if DEBOUNCE_ADAPTIVE
+  pulseDebounce_ = AdaptiveDebounce(timing.pulseDebounceUs, PULSE_DEBOUNCE_MIN_US, PULSE_DEBOUNCE_MAX_US,
+                                    PULSE_MIN_WIDTH_US);
+  dialDebounce_ = AdaptiveDebounce(timing.dialDebounceUs, DIAL_DEBOUNCE_MIN_US, DIAL_DEBOUNCE_MAX_US,
+                                   DIAL_MIN_WIDTH_US);
+#else
+  pulseDebounce_ = AdaptiveDebounce(timing.pulseDebounceUs, timing.pulseDebounceUs, timing.pulseDebounceUs, 0);
+  dialDebounce_ = AdaptiveDebounce(timing.dialDebounceUs, timing.dialDebounceUs, timing.dialDebounceUs, 0);
+#endif
+}
+
+template <typename Dial>
+void BasicDialDecoder<Dial>::reset() {
+  bool earlyDigit = earlyDigit_;
+  uint8_t shuntMode = shuntMode_;
+  DialTiming timing = timing_;
+  *this = BasicDialDecoder<Dial>();
+  earlyDigit_ = earlyDigit;
+  setShuntMode(shuntMode);
+  setTiming(timing);
+}
+
+// Dial types built into the firmware
+template class BasicDialDecoder<BreakCountingDial>;
+template class BasicDialDecoder<MakeCountingDial>;
@@ -0,0 +1,268 @@
+/*
+ * Dial Decoder
+ *
+ * Turns debounced pulse/shunt edges into dial events. Pure logic with no
+ * hardware access: callers pass in the edge time (microseconds) and pin
+ * level, and get back at most one event per call. This is what the
+ * firmware runs in loop() and what the host tools drive with scripted
+ * edges.
+ *
+ * After debouncing, each edge becomes one DialInput and the decoder takes
+ * one step through a constexpr transition table. The table is generated
+ * at compile time per dial type (see the dial type traits below), so the
+ * hot path is a table lookup plus a few flag tests. Dials without a
+ * working shunt run from a second, pulse-only table (see DIAL_SHUNT_MODE).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "dial_config.h"
+#include "adaptive_debounce.h"
+
+enum DialEventType : uint8_t {
+  DIAL_EVENT_NONE = 0,
+  DIAL_EVENT_STARTED,   // Shunt opened - dial started turning
+  DIAL_EVENT_PULSE,     // Pulse counted (pulses = running count)
+  DIAL_EVENT_RESTED,    // Shunt closed - dial returned to rest (pulses = final count)
+  DIAL_EVENT_TIMEOUT,   // Safety timeout - shunt never closed (pulses = final count)
+  DIAL_EVENT_PROVISIONAL  // Pulse gap says the digit is over (pulses = predicted count)
+};
+
+// DialEvent flags. CONFIRMED and CORRECTED only go on the RESTED/TIMEOUT
+// event that follows a provisional digit; SUSPECT and REPAIRED can go on
+// any PROVISIONAL, RESTED or TIMEOUT event that carries a count.
+#define DIAL_FLAG_CONFIRMED 0x01   // Final count matches the provisional digit
+#define DIAL_FLAG_CORRECTED 0x02   // Final count differs - provisional digit was wrong
+#define DIAL_FLAG_SUSPECT   0x04   // Timing disagrees with the count (confidence below DIAL_CONFIDENCE_MIN)
+#define DIAL_FLAG_REPAIRED  0x08   // Count adjusted for a missed or split pulse
+
+struct DialEvent {
+  DialEventType type;
+  uint8_t pulses;
+  uint64_t time;    // Microseconds
+  uint8_t line;     // Dial the event belongs to (0 for single-dial decoders)
+  uint8_t flags;    // DIAL_FLAG_* bits
+  uint8_t confidence;  // 0-100, how well pulse timing supports the count (100 if not assessed)
+};
+
+typedef void (*DialEventHandler)(const DialEvent& event);
+
+// Convert pulse count to digit (10 pulses = 0)
+inline int pulsesToDigit(int pulses) {
+  return (pulses == 10) ? 0 : pulses;
+}
+
+enum DialState : uint8_t {
+  DIAL_STATE_IDLE = 0,      // At rest, nothing dialed yet
+  DIAL_STATE_OFF_NORMAL,    // Shunt open, no pulse seen yet
+  DIAL_STATE_PULSE_MAKE,    // Off-normal, pulse contact closed
+  DIAL_STATE_PULSE_BREAK,   // Off-normal, pulse contact open
+  DIAL_STATE_COMPLETE,      // Back at rest after a digit
+  DIAL_STATE_FAULT,         // Safety timeout hit - waiting for the shunt to close
+  DIAL_STATE_PROVISIONAL,   // Off-normal, pulse gap passed - digit reported early
+  DIAL_STATE_COUNT
+};
+
+enum DialInput : uint8_t {
+  DIAL_INPUT_SHUNT_OPEN = 0,  // Shunt went LOW (dial off-normal)
+  DIAL_INPUT_SHUNT_CLOSE,     // Shunt went HIGH (dial at rest)
+  DIAL_INPUT_PULSE_BREAK,     // Pulse contact opened (pin HIGH)
+  DIAL_INPUT_PULSE_MAKE,      // Pulse contact closed (pin LOW)
+  DIAL_INPUT_TIMEOUT,         // Safety timeout expired
+  DIAL_INPUT_GAP,             // Pulse gap exceeded the learned period
+  DIAL_INPUT_COUNT
+};
+
+// Transition actions (bit flags)
+#define DIAL_ACTION_RESET 0x01   // Clear the pulse count
+#define DIAL_ACTION_COUNT 0x02   // Count one pulse
+#define DIAL_ACTION_ARM   0x04   // Restart the safety timeout
+
+struct DialTransition {
+  uint8_t next;                // DialState
+  uint8_t actions;             // DIAL_ACTION_* flags
+  DialEventType event;         // Event reported for this step
+};
+
+struct DialTransitionTable {
+  DialTransition entry[DIAL_STATE_COUNT][DIAL_INPUT_COUNT];
+};
+
+// Dial type traits: which pulse contact transition marks a pulse
+struct BreakCountingDial {
+  static constexpr DialInput countInput = DIAL_INPUT_PULSE_BREAK;   // Count on HIGH transitions (this wiring)
+};
+
+struct MakeCountingDial {
+  static constexpr DialInput countInput = DIAL_INPUT_PULSE_MAKE;    // Pulse contact wired normally open
+};
+
+constexpr bool isDialingState(uint8_t state) {
+  return state == DIAL_STATE_OFF_NORMAL || state == DIAL_STATE_PULSE_MAKE
+      || state == DIAL_STATE_PULSE_BREAK || state == DIAL_STATE_PROVISIONAL;
+}
+
+// pulseOnly builds the table for dials without a shunt: shunt inputs are
+// ignored, a pulse at rest opens a digit and the timeout (a pulse gap)
+// is the normal end of one
+template <typename Dial>
+constexpr DialTransitionTable buildDialTable(bool pulseOnly) {
+  DialTransitionTable table = {};
+  
+  for (int state = 0; state < DIAL_STATE_COUNT; state++) {
+    bool dialing = isDialingState(state);
+    bool resting = state == DIAL_STATE_IDLE || state == DIAL_STATE_COMPLETE;
+    
+    for (int input = 0; input < DIAL_INPUT_COUNT; input++) {
+      // Default: stay put, do nothing
+      DialTransition t = { (uint8_t)state, 0, DIAL_EVENT_NONE };
+      bool shuntInput = input == DIAL_INPUT_SHUNT_OPEN || input == DIAL_INPUT_SHUNT_CLOSE;
+      
+      if (pulseOnly && shuntInput) {
+        // No shunt to listen to
+      } else if (input == DIAL_INPUT_SHUNT_OPEN && (state == DIAL_STATE_IDLE || state == DIAL_STATE_COMPLETE)) {
+        // Start dialing when shunt goes LOW
+        t = { DIAL_STATE_OFF_NORMAL, DIAL_ACTION_RESET | DIAL_ACTION_ARM, DIAL_EVENT_STARTED };
+      } else if (input == DIAL_INPUT_SHUNT_CLOSE && dialing) {
+        // End dialing when shunt goes HIGH (dial returned to rest)
+        t = { DIAL_STATE_COMPLETE, 0, DIAL_EVENT_RESTED };
+      } else if (input == DIAL_INPUT_SHUNT_CLOSE && state == DIAL_STATE_FAULT) {
+        t = { DIAL_STATE_IDLE, 0, DIAL_EVENT_NONE };
+      } else if (input == Dial::countInput && (state == DIAL_STATE_FAULT || (pulseOnly && resting))) {
+        // Shunt stuck off-normal, or none at all: a new pulse train starts the next digit
+        uint8_t next = (input == DIAL_INPUT_PULSE_BREAK) ? DIAL_STATE_PULSE_BREAK : DIAL_STATE_PULSE_MAKE;
+        t = { next, DIAL_ACTION_RESET | DIAL_ACTION_COUNT | DIAL_ACTION_ARM, DIAL_EVENT_PULSE };
+      } else if (input == DIAL_INPUT_TIMEOUT && dialing && pulseOnly) {
+        // Pulse gap: without a shunt this is how every digit ends
+        t = { DIAL_STATE_COMPLETE, 0, DIAL_EVENT_RESTED };
+      } else if (input == DIAL_INPUT_TIMEOUT && dialing) {
+        t = { DIAL_STATE_FAULT, 0, DIAL_EVENT_TIMEOUT };
+      } else if (input == DIAL_INPUT_GAP && state == DIAL_STATE_PULSE_MAKE) {
+        // Digit looks complete; stay off-normal until the shunt confirms
+        t = { DIAL_STATE_PROVISIONAL, 0, DIAL_EVENT_PROVISIONAL };
+      } else if ((input == DIAL_INPUT_PULSE_BREAK || input == DIAL_INPUT_PULSE_MAKE) && dialing) {
+        uint8_t next = (input == DIAL_INPUT_PULSE_BREAK) ? DIAL_STATE_PULSE_BREAK : DIAL_STATE_PULSE_MAKE;
+        if (input == Dial::countInput) {
+          t = { next, DIAL_ACTION_COUNT | DIAL_ACTION_ARM, DIAL_EVENT_PULSE };
+        } else {
+          t = { next, 0, DIAL_EVENT_NONE };
+        }
+      }
+      
+      table.entry[state][input] = t;
+    }
+  }
+  return table;
+}
+
+// Timing the decoder runs with: the dial_config.h values unless a tuned
+// profile is loaded (see dial_profile.h)
+struct DialTiming {
+  uint32_t pulseDebounceUs = PULSE_DEBOUNCE_US;    // Starting debounce windows
+  uint32_t dialDebounceUs = DIAL_DEBOUNCE_US;
+  uint32_t timeoutUs = DIAL_TIMEOUT_US;            // The safety timeout is twice this
+  uint32_t timeoutMinUs = DIAL_TIMEOUT_MIN_US;
+  uint32_t timeoutPeriods = DIAL_TIMEOUT_PERIODS;
+};
+
+template <typename Dial>
+class BasicDialDecoder {
+public:
+  static constexpr DialTransitionTable table = buildDialTable<Dial>(false);
+  static constexpr DialTransitionTable pulseOnlyTable = buildDialTable<Dial>(true);
+
+  DialEvent pulseEdge(uint64_t now, bool currentPulseState);
+  DialEvent shuntEdge(uint64_t now, bool currentDialState);
+  DialEvent poll(uint64_t now);   // Safety timeout check
+  void reset();
+
+  // Pulse total from a hardware counter (see DIAL_COUNTER) in place of
+  // pulse edges; counts as progress for the completion timeout
+  void setCountedPulses(int pulses, uint64_t now);
+  
+  // Pin levels at startup, so the first real edge is not mistaken for
+  // (or hidden as) a repeat of the assumed idle level
+  void setInitialLevels(bool pulseState, bool dialState);
+
+  // Next time poll() has work to do (completion timeout or early digit gap),
+  // 0 when idle
+  uint64_t deadline() const;
+
+  const AdaptiveDebounce& pulseDebounce() const { return pulseDebounce_; }
+  const AdaptiveDebounce& dialDebounce() const { return dialDebounce_; }
+
+  // Predictive completion (see DIAL_EARLY_DIGIT)
+  void setEarlyDigit(bool enabled) { earlyDigit_ = enabled; }
+  uint32_t learnedPeriod() const { return periodUs_; }
+
+  // Current completion timeout after the last pulse (see DIAL_TIMEOUT_ADAPTIVE)
+  uint32_t completionTimeout() const;
+  uint32_t safetyTimeout() const { return safetyTimeoutUs_; }
+  
+  // Replace the timing; restarts both debounce windows from its values
+  void setTiming(const DialTiming& timing);
+  const DialTiming& timing() const { return timing_; }
+  
+  // Shunt handling (see DIAL_SHUNT_MODE); pulseOnly() is the mode in use,
+  // which DIAL_SHUNT_AUTO changes as it learns whether a shunt is wired
+  void setShuntMode(uint8_t mode);
+  uint8_t shuntMode() const { return shuntMode_; }
+  bool pulseOnly() const { return pulseOnly_; }
+
+  DialState state() const { return (DialState)state_; }
+  bool isDialing() const { return isDialingState(state_); }
+  int pulseCount() const { return pulseCount_; }
+
+private:
+  DialEvent step(DialInput input, uint64_t now);
+  uint64_t gapDeadline() const;
+  bool shuntLost(uint64_t now);
+  void assess(DialEvent& event, bool shuntClosed) const;
+
+  DialTiming timing_;
+  uint32_t safetyTimeoutUs_ = DIAL_SAFETY_TIMEOUT_US;
+  
+  uint8_t state_ = DIAL_STATE_IDLE;
+  int pulseCount_ = 0;
+  uint64_t dialingTimeout_ = 0;
+
+  // Pulse cadence learning for early digits and the adaptive timeout
+  bool earlyDigit_ = DIAL_EARLY_DIGIT;
+  uint64_t lastPulseTime_ = 0;
+  uint32_t periodUs_ = 0;          // Running average of inter-pulse intervals
+  uint32_t restLagUs_ = 0;         // Decaying max of last pulse to shunt close
+  uint8_t provisionalPulses_ = 0;  // Count reported early, 0 if none
+  
+  // Timing evidence for the digit confidence
+  static constexpr int MAX_INTERVALS = 15;
+  uint64_t firstPulseTime_ = 0;
+  uint32_t intervals_[MAX_INTERVALS] = {};
+  uint8_t intervalCount_ = 0;
+  uint32_t lagAvgUs_ = 0;          // Running average of last pulse to shunt close
+  uint32_t lagDevUs_ = 0;          // Running mean deviation of that lag
+  
+  // Shunt detection
+  uint8_t shuntMode_ = DIAL_SHUNT_MODE;
+  bool pulseOnly_ = DIAL_SHUNT_MODE != DIAL_SHUNT_WIRED;
+  uint8_t restPulses_ = 0;         // Pulses at rest since the shunt was last active
+  uint8_t restTrain_ = 0;          // Pulses at rest in the current train
+  uint64_t lastRestPulse_ = 0;
+
+  // Debounce tracking
+#if DEBOUNCE_ADAPTIVE
+  AdaptiveDebounce pulseDebounce_ = AdaptiveDebounce(PULSE_DEBOUNCE_US, PULSE_DEBOUNCE_MIN_US,
+                                                     PULSE_DEBOUNCE_MAX_US, PULSE_MIN_WIDTH_US);
+  AdaptiveDebounce dialDebounce_ = AdaptiveDebounce(DIAL_DEBOUNCE_US, DIAL_DEBOUNCE_MIN_US,
+                                                    DIAL_DEBOUNCE_MAX_US, DIAL_MIN_WIDTH_US);
+#else
+  AdaptiveDebounce pulseDebounce_ = AdaptiveDebounce(PULSE_DEBOUNCE_US, PULSE_DEBOUNCE_US, PULSE_DEBOUNCE_US, 0);
+  AdaptiveDebounce dialDebounce_ = AdaptiveDebounce(DIAL_DEBOUNCE_US, DIAL_DEBOUNCE_US, DIAL_DEBOUNCE_US, 0);
+#endif
+  bool lastDialState_ = true;
+  bool lastPulseState_ = true;
+  uint64_t lastPulseDebounce_ = 0;
+  uint64_t lastDialDebounce_ = 0;
+};
+
+typedef BasicDialDecoder<BreakCountingDial> DialDecoder;
@@ -0,0 +1,331 @@
+/*
+ * Dial Input - see dial_input.h
+ */
+
+#include "dial_input.h"
+#include "dial_log.h"
+#include "edge_trace.h"
+#include "hal.h"
+#include "latency_stats.h"
+#include "pulse_counter.h"
+#include "pulse_capture.h"
+#include <string.h>
+
+SpscRing<EdgeEvent, EDGE_RING_SIZE> edgeRing;
+SpscRing<EdgeEvent, EDGE_RING_SIZE> captureRing;
+DialDecoder dialDecoder;
+
+#define PULSE_MASK (1UL << ROTARY_PULSE_PIN)
+#define SHUNT_MASK (1UL << ROTARY_SHUNT_PIN)
+
+// Input word as of the last ISR run (only touched by onDialEdge after setup)
+static uint32_t lastInputs = PULSE_MASK | SHUNT_MASK;
+
+// Lines decoded from edges; the pulse line drops out with the PCNT counter
+// and the RMT capture
+static uint8_t counterBackend = DIAL_COUNTER;
+static uint32_t edgeMask = PULSE_MASK | SHUNT_MASK;
+
+// Settle sampling state, shared by onDialEdge and onSettleTimer under
+// halEnterCritical(). onSettleTimer is then the ring's only producer.
+static bool settleSampling = DIAL_SETTLE_SAMPLING;
+static uint32_t settledInputs = PULSE_MASK | SHUNT_MASK;   // Levels last queued
+static uint32_t burstPins = 0;           // Pins with raw edges since the last vote
+static uint64_t burstStart[2];           // First raw edge of the burst, by EDGE_* line
+static uint8_t samplesTaken = 0;
+static uint8_t highVotes[2];
+
+// RMT capture: a frame's pulse edges reach loop() up to
+// PULSE_CAPTURE_IDLE_US after they happened, so every edge waits in
+// staged[] (time order) until no frame can still bring an earlier one
+#define CAPTURE_LAG_US (PULSE_CAPTURE_IDLE_US + PULSE_CAPTURE_MARGIN_US)
+static EdgeEvent staged[EDGE_RING_SIZE];
+static size_t stagedCount = 0;
+static PulseSymbol lastFrame[PULSE_CAPTURE_MAX_SYMBOLS];   // Guarded by halEnterCritical()
+static size_t lastFrameCount = 0;
+static uint32_t framesCaptured = 0;
+
+// The GPIO interrupt handler for both dial pins. One read of the
+// input register gives both levels at the same instant; an edge is queued
+// for each pin whose level differs from the last snapshot.
+void IRAM_ATTR onDialEdge() {
+  uint64_t now = halMicros();
+  uint32_t inputs = halReadInputs();
+  uint32_t changed = (inputs ^ lastInputs) & edgeMask;
+  lastInputs = inputs;
+  dialLog(LOG_EDGE, inputs, changed);
+  if (changed & PULSE_MASK) {
+    edgeTraceRecord(now, EDGE_PULSE, (inputs & PULSE_MASK) ? HIGH : LOW);
+  }
+  if (changed & SHUNT_MASK) {
+    edgeTraceRecord(now, EDGE_SHUNT, (inputs & SHUNT_MASK) ? HIGH : LOW);
+  }
+  
+  if (settleSampling) {
+    // Note when the burst began and wait for the lines to go quiet; any
+    // samples already taken were mid-bounce, so the vote starts over
+    if (changed) {
+      halEnterCritical();
+      if ((changed & PULSE_MASK) && !(burstPins & PULSE_MASK)) {
+        burstStart[EDGE_PULSE] = now;
+      }
+      if ((changed & SHUNT_MASK) && !(burstPins & SHUNT_MASK)) {
+        burstStart[EDGE_SHUNT] = now;
+      }
+      burstPins |= changed;
+      samplesTaken = 0;
+      highVotes[EDGE_PULSE] = highVotes[EDGE_SHUNT] = 0;
+      halExitCritical();
+      halArmSettle(SETTLE_US);
+    }
+    return;
+  }
+  
+  if (changed & PULSE_MASK) {
+    EdgeEvent event = { now, EDGE_PULSE, (uint8_t)((inputs & PULSE_MASK) ? HIGH : LOW) };
+    edgeRing.push(event);
+  }
+  if (changed & SHUNT_MASK) {
+    EdgeEvent event = { now, EDGE_SHUNT, (uint8_t)((inputs & SHUNT_MASK) ? HIGH : LOW) };
+    edgeRing.push(event);
+  }
+  if (changed) {
+    halNotifyFromIsr();
+  }
+}
+
+// Settle timer callback: take one sample, and once SETTLE_SAMPLES are in,
+// queue an edge for each line whose majority level differs from the last
+// one queued. A burst that ends where it started (a glitch) queues nothing.
+void onSettleTimer() {
+  uint32_t inputs = halReadInputs();
+  bool queued = false;
+  uint32_t glitchPins = 0;
+  
+  halEnterCritical();
+  highVotes[EDGE_PULSE] += (inputs & PULSE_MASK) != 0;
+  highVotes[EDGE_SHUNT] += (inputs & SHUNT_MASK) != 0;
+  bool done = ++samplesTaken >= SETTLE_SAMPLES;
+  if (done) {
+    static const uint32_t masks[2] = { PULSE_MASK, SHUNT_MASK };
+    for (uint8_t line = EDGE_PULSE; line <= EDGE_SHUNT; line++) {
+      bool high = highVotes[line] * 2 > SETTLE_SAMPLES;
+      if ((edgeMask & masks[line]) && high != ((settledInputs & masks[line]) != 0)) {
+        uint64_t time = (burstPins & masks[line]) ? burstStart[line] : halMicros();
+        EdgeEvent event = { time, line, (uint8_t)(high ? HIGH : LOW) };
+        edgeRing.push(event);
+        settledInputs ^= masks[line];
+        queued = true;
+      }
+      highVotes[line] = 0;
+    }
+    glitchPins = queued ? 0 : burstPins;
+    burstPins = 0;
+    samplesTaken = 0;
+  }
+  halExitCritical();
+  
+  if (!done) {
+    halArmSettle(SETTLE_SAMPLE_SPACING_US);
+  } else if (queued) {
+    dialLog(LOG_SETTLE_VOTE, settledInputs & PULSE_MASK ? HIGH : LOW, settledInputs & SHUNT_MASK ? HIGH : LOW);
+    halNotifyConsumer();
+  } else if (glitchPins) {
+    dialLog(LOG_SETTLE_GLITCH, glitchPins);
+  }
+}
+
+// Capture task callback: queue the frame's pulse edges for loop() and
+// keep a copy of the raw frame for diagnostics
+static void onPulseFrame(const PulseSymbol* symbols, size_t count, uint64_t endTime) {
+  static EdgeEvent edges[2 * PULSE_CAPTURE_MAX_SYMBOLS];
+  
+  // The trace gets every level change, bounce included
+  size_t edgeCount = pulseFrameToEdges(symbols, count, endTime, PULSE_CAPTURE_IDLE_US, 0,
+                                       EDGE_PULSE, edges, 2 * PULSE_CAPTURE_MAX_SYMBOLS);
+  for (size_t i = 0; i < edgeCount; i++) {
+    edgeTraceRecord(edges[i].time, edges[i].pin, edges[i].level);
+  }
+  
+  edgeCount = pulseFrameToEdges(symbols, count, endTime, PULSE_CAPTURE_IDLE_US, PULSE_CAPTURE_MIN_US,
+                                       EDGE_PULSE, edges, 2 * PULSE_CAPTURE_MAX_SYMBOLS);
+  uint32_t lost = 0;
+  for (size_t i = 0; i < edgeCount; i++) {
+    lost += !captureRing.push(edges[i]);
+  }
+  dialLog(LOG_CAPTURE_FRAME, count, edgeCount);
+  if (lost) {
+    dialLog(LOG_CAPTURE_OVERFLOW, lost, edgeCount);
+  }
+  
+  halEnterCritical();
+  lastFrameCount = count < PULSE_CAPTURE_MAX_SYMBOLS ? count : PULSE_CAPTURE_MAX_SYMBOLS;
+  memcpy(lastFrame, symbols, lastFrameCount * sizeof(PulseSymbol));
+  framesCaptured++;
+  halExitCritical();
+  halNotifyConsumer();
+}
+
+uint32_t dialInputLastFrame(PulseSymbol* symbols, size_t maxSymbols, size_t* count) {
+  halEnterCritical();
+  *count = lastFrameCount < maxSymbols ? lastFrameCount : maxSymbols;
+  memcpy(symbols, lastFrame, *count * sizeof(PulseSymbol));
+  uint32_t frames = framesCaptured;
+  halExitCritical();
+  return frames;
+}
+
+void dialInputSetSettleSampling(bool enabled) {
+  settleSampling = enabled;
+}
+
+void dialInputSetCounter(uint8_t backend) {
+  counterBackend = backend;
+}
+
+void dialInputBegin() {
+  // Configure pins with internal pull-ups
+  halPinInputPullup(ROTARY_PULSE_PIN);
+  halPinInputPullup(ROTARY_SHUNT_PIN);
+  lastInputs = halReadInputs();
+  settledInputs = lastInputs;
+  dialDecoder.setInitialLevels(lastInputs & PULSE_MASK, lastInputs & SHUNT_MASK);
+  halBindConsumer();
+  halBindSettleCallback(onSettleTimer);
+  
+  // The hardware counter only knows totals, so the shunt must frame every
+  // digit; fall back to edge decoding if the counter is unavailable
+  if ((counterBackend == DIAL_COUNTER_PCNT && !pulseCounterBegin(ROTARY_PULSE_PIN, PCNT_FILTER_NS)) ||
+      (counterBackend == DIAL_COUNTER_RMT &&
+       !pulseCaptureBegin(ROTARY_PULSE_PIN, PULSE_CAPTURE_IDLE_US, onPulseFrame))) {
+    dialLog(LOG_COUNTER_FALLBACK, counterBackend);
+    counterBackend = DIAL_COUNTER_ISR;
+  }
+  if (counterBackend == DIAL_COUNTER_PCNT) {
+    edgeMask = SHUNT_MASK;
+    dialDecoder.setShuntMode(DIAL_SHUNT_WIRED);
+  } else if (counterBackend == DIAL_COUNTER_RMT) {
+    edgeMask = SHUNT_MASK;
+  } else {
+    edgeMask = PULSE_MASK | SHUNT_MASK;
+  }
+  
+  // One GPIO interrupt for both pins: edges that land together cost a
+  // single entry into onDialEdge
+  halAttachPinsInterrupt(edgeMask, onDialEdge);
+}
+
+// Run decoder deadlines that fell due at or before t, in time order
+static void pollUntil(uint64_t t, DialEventHandler handler) {
+  uint64_t due = dialDecoder.deadline();
+  while (due && due <= t) {
+    DialEvent event = dialDecoder.poll(due);
+    if (event.type != DIAL_EVENT_NONE) {
+      handler(event);
+    }
+    uint64_t next = dialDecoder.deadline();
+    if (next == due) {
+      break;
+    }
+    due = next;
+  }
+}
+
+// Run one edge through the decoder, after any deadline that fell due
+// before it
+static void feedEdge(const EdgeEvent& edge, DialEventHandler handler) {
+  // A timeout that expired before this edge happened must fire first,
+  // even if loop() only got to run after the edge was queued
+  pollUntil(edge.time, handler);
+  
+  if (counterBackend == DIAL_COUNTER_PCNT) {
+    // The dial is at rest again by the time the shunt closes, so the
+    // total read now is the digit's
+    dialDecoder.setCountedPulses(pulseCounterRead(), edge.time);
+  }
+  DialEvent event = (edge.pin == EDGE_PULSE)
+    ? dialDecoder.pulseEdge(edge.time, edge.level)
+    : dialDecoder.shuntEdge(edge.time, edge.level);
+  if (counterBackend == DIAL_COUNTER_PCNT && event.type == DIAL_EVENT_STARTED) {
+    pulseCounterClear();   // Wind-up leaves time before the first break
+  }
+  if (event.type != DIAL_EVENT_NONE) {
+    uint64_t accepted = halMicros();
+    latencyRecord(LATENCY_ACCEPT, edge.time, accepted);
+    if (event.type == DIAL_EVENT_RESTED && event.pulses > 0) {
+      latencyRecord(LATENCY_DECISION, edge.time, accepted);
+    }
+    handler(event);
+  }
+}
+
+// Move queued edges into staged[], keeping it in time order. Edges stay
+// in their ring while staged[] is full, so ring drops still count losses.
+static void stageEdges(SpscRing<EdgeEvent, EDGE_RING_SIZE>& ring) {
+  EdgeEvent edge;
+  while (stagedCount < EDGE_RING_SIZE && ring.pop(edge)) {
+    size_t i = stagedCount++;
+    while (i > 0 && staged[i - 1].time > edge.time) {
+      staged[i] = staged[i - 1];
+      i--;
+    }
+    staged[i] = edge;
+  }
+}
+
+void dialInputProcess(DialEventHandler handler) {
+  edgeTraceFlush();   // The ISRs only stage raw edges for the trace
+  
+  uint64_t now;
+  if (counterBackend == DIAL_COUNTER_RMT) {
+    // Merge the shunt edges and the captured pulse edges, and decode only
+    // up to the point where every frame that could hold an earlier pulse
+    // edge has been delivered
+    stageEdges(edgeRing);
+    stageEdges(captureRing);
+    now = halMicros();
+    uint64_t horizon = now > CAPTURE_LAG_US ? now - CAPTURE_LAG_US : 0;
+    size_t released = 0;
+    while (released < stagedCount && staged[released].time <= horizon) {
+      feedEdge(staged[released++], handler);
+    }
+    stagedCount -= released;
+    memmove(staged, staged + released, stagedCount * sizeof(EdgeEvent));
+    pollUntil(horizon, handler);
+  } else {
+    // Drain queued edges in arrival order
+    EdgeEvent edge;
+    while (edgeRing.pop(edge)) {
+      feedEdge(edge, handler);
+    }
+    now = halMicros();
+    if (counterBackend == DIAL_COUNTER_PCNT) {
+      dialDecoder.setCountedPulses(pulseCounterRead(), now);
+    }
+    pollUntil(now, handler);
+  }
+  
+  // Keep the one-shot safety timer in step with the next deadline
+  static uint64_t armedDeadline = 0;
+  uint64_t deadline = dialInputDeadline();
+  if (deadline != armedDeadline) {
+    if (deadline) {
+      halArmTimeout(deadline > now ? deadline - now : 1);
+    } else {
+      halCancelTimeout();
+    }
+    armedDeadline = deadline;
+  }
+}
+
+uint64_t dialInputDeadline() {
+  uint64_t deadline = dialDecoder.deadline();
+  if (counterBackend != DIAL_COUNTER_RMT) {
+    return deadline;
+  }
+  // Decoding runs CAPTURE_LAG_US behind, and staged edges are due too
+  if (stagedCount > 0 && (!deadline || staged[0].time < deadline)) {
+    deadline = staged[0].time;
+  }
+  return deadline ? deadline + CAPTURE_LAG_US : 0;
+}
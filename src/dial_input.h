@@ -0,0 +1,53 @@
+/*
+ * Dial Input
+ *
+ * Interrupt side of the dial: onDialEdge() snapshots both pins from one
+ * input register read and queues raw edges into the edge ring, and dialInputProcess() drains them through the
+ * decoder from loop() context. Hardware access goes through hal.h only.
+ *
+ * With settle sampling (DIAL_SETTLE_SAMPLING) the ISR queues nothing itself:
+ * it restarts the settle timer, and onSettleTimer() queues the voted levels.
+ * With the PCNT counter (DIAL_COUNTER) only the shunt has an interrupt, and
+ * the pulse total is read from pulse_counter.h as the shunt moves. With the
+ * RMT capture (pulse_capture.h) pulse edges come from whole frames instead,
+ * and everything is decoded one idle threshold (plus a margin) behind so
+ * the two lines merge in time order.
+ */
+
+#pragma once
+
+#include "dial_decoder.h"
+#include "edge_ring.h"
+#include "dial_config.h"
+#include "pulse_capture.h"
+
+extern SpscRing<EdgeEvent, EDGE_RING_SIZE> edgeRing;
+extern SpscRing<EdgeEvent, EDGE_RING_SIZE> captureRing;   // Pulse edges from RMT frames
+extern DialDecoder dialDecoder;
+
+static_assert(ROTARY_PULSE_PIN < 32 && ROTARY_SHUNT_PIN < 32,
+              "Dial pins must share the first GPIO input register");
+
+void onDialEdge();
+void onSettleTimer();
+
+// Configure pins and attach the edge interrupts. The calling task becomes
+// the consumer that the ISRs and the safety timer wake up.
+void dialInputBegin();
+
+// Switch settle sampling on or off, or pick the counting backend
+// (DIAL_COUNTER_*). Call before dialInputBegin().
+void dialInputSetSettleSampling(bool enabled);
+void dialInputSetCounter(uint8_t backend);
+
+// Drain queued edges through the decoder, then run the safety timeout and
+// re-arm its one-shot timer. Each resulting event is passed to handler.
+void dialInputProcess(DialEventHandler handler);
+
+// Time dialInputProcess() next has work to do even without a new edge:
+// the decoder's deadline, delayed by the capture lag in RMT mode. 0 if none.
+uint64_t dialInputDeadline();
+
+// Copy the last RMT frame into symbols and its length into count; returns
+// the number of frames captured so far (0: none yet)
+uint32_t dialInputLastFrame(PulseSymbol* symbols, size_t maxSymbols, size_t* count);
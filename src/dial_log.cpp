@@ -0,0 +1,22 @@
+/*
+ * Dial Log - see dial_log.h
+ */
+
+#include "dial_log.h"
+#include "dial_config.h"
+#include <stdio.h>
+
+SpscRing<DialLogRecord, DIAL_LOG_RING_SIZE> dialLogRing;
+volatile uint8_t dialLogLevel = DIAL_LOG_LEVEL;
+
+#define DIAL_LOG_X_FORMAT(id, level, format) format,
+static const char* const formats[] = { DIAL_LOG_FORMATS(DIAL_LOG_X_FORMAT) };
+#undef DIAL_LOG_X_FORMAT
+
+int dialLogFormat(const DialLogRecord& record, char* out, size_t size) {
+  if (record.id >= DIAL_LOG_ID_COUNT) {
+    return snprintf(out, size, "unknown log id %u (%u, %u)",
+                    (unsigned)record.id, (unsigned)record.args[0], (unsigned)record.args[1]);
+  }
+  return snprintf(out, size, formats[record.id], (unsigned)record.args[0], (unsigned)record.args[1]);
+}
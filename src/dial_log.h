@@ -0,0 +1,75 @@
+/*
+ * Dial Log
+ *
+ * Deferred-format logging for ISRs, timer callbacks and the capture task.
+ * A log call stores a timestamp, a format ID and up to two raw arguments
+ * in a preallocated ring and returns; nothing is formatted or sent there.
+ * loop() later drains the ring, and either formats each record from the
+ * table below or, in binary telemetry mode, sends it raw for the host to
+ * format with the same table (program telemetry).
+ *
+ * A record whose level is above dialLogLevel is rejected by one compare,
+ * so DIAL_LOG_DEBUG records can stay in the hot paths and be switched on
+ * for diagnostics (the 'v' key) without changing their timing much.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "edge_ring.h"
+#include "hal.h"
+
+#define DIAL_LOG_WARN 1
+#define DIAL_LOG_INFO 2
+#define DIAL_LOG_DEBUG 3
+
+// Format table: ID, level, printf format taking up to two unsigned args.
+// IDs are sent over the wire, so only ever append to this list.
+#define DIAL_LOG_FORMATS(X) \
+  X(LOG_EDGE,             DIAL_LOG_DEBUG, "edge: inputs 0x%08x changed 0x%08x") \
+  X(LOG_SETTLE_GLITCH,    DIAL_LOG_INFO,  "settle: burst on pins 0x%08x ended where it started") \
+  X(LOG_SETTLE_VOTE,      DIAL_LOG_DEBUG, "settle: voted pulse %u, shunt %u") \
+  X(LOG_CAPTURE_FRAME,    DIAL_LOG_DEBUG, "capture: frame of %u symbols, %u edges") \
+  X(LOG_CAPTURE_OVERFLOW, DIAL_LOG_WARN,  "capture: %u of %u frame edges lost, ring full") \
+  X(LOG_COUNTER_FALLBACK, DIAL_LOG_WARN,  "counter: backend %u unavailable, using interrupts")
+
+#define DIAL_LOG_X_ID(id, level, format) id,
+enum DialLogId : uint8_t {
+  DIAL_LOG_FORMATS(DIAL_LOG_X_ID)
+  DIAL_LOG_ID_COUNT
+};
+#undef DIAL_LOG_X_ID
+
+struct DialLogRecord {
+  uint64_t time;   // halMicros() at the log call
+  uint8_t id;      // DialLogId
+  uint32_t args[2];
+};
+
+#define DIAL_LOG_RING_SIZE 128
+
+extern SpscRing<DialLogRecord, DIAL_LOG_RING_SIZE> dialLogRing;
+extern volatile uint8_t dialLogLevel;   // Records above this level are dropped at the call
+
+constexpr uint8_t dialLogLevelOf(DialLogId id) {
+#define DIAL_LOG_X_LEVEL(id, level, format) level,
+  constexpr uint8_t levels[] = { DIAL_LOG_FORMATS(DIAL_LOG_X_LEVEL) 0 };
+#undef DIAL_LOG_X_LEVEL
+  return levels[id];
+}
+
+// Record a log entry from any context. Producers in different contexts
+// share the ring, so the push is made under the HAL's critical section.
+RING_INLINE void dialLog(DialLogId id, uint32_t a = 0, uint32_t b = 0) {
+  if (dialLogLevelOf(id) > dialLogLevel) {
+    return;
+  }
+  DialLogRecord record = { halMicros(), id, { a, b } };
+  halEnterCritical();
+  dialLogRing.push(record);
+  halExitCritical();
+}
+
+// Format a record's message (without timestamp) into out; returns its length
+int dialLogFormat(const DialLogRecord& record, char* out, size_t size);
@@ -0,0 +1,15 @@
+/*
+ * Dial Profile - see dial_profile.h
+ */
+
+#include "dial_profile.h"
+#include "hal.h"
+
+DialTiming dialProfileLoad() {
+  DialTiming timing;
+#define DIAL_PROFILE_X_LOAD(field, key, constant) \
+  timing.field = halLoadSetting(DIAL_PROFILE_NAMESPACE, key, timing.field);
+  DIAL_PROFILE_FIELDS(DIAL_PROFILE_X_LOAD)
+#undef DIAL_PROFILE_X_LOAD
+  return timing;
+}
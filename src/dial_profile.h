@@ -0,0 +1,31 @@
+/*
+ * Dial Profile
+ *
+ * Decoder timing (DialTiming) stored in NVS, so a profile picked with
+ * "program tune" reaches the dial without rebuilding the firmware. The
+ * tune tool writes it as a CSV for ESP-IDF's NVS partition generator:
+ *
+ *   program tune corpus/golden.txt nvs=profile.csv
+ *   nvs_partition_gen.py generate profile.csv nvs.bin 0x5000
+ *   esptool.py write_flash 0x9000 nvs.bin     # replaces the NVS partition
+ *
+ * Keys missing from NVS keep their dial_config.h values. To build a
+ * profile in instead, export it as src/dial_tuning.h (tune header=...).
+ */
+
+#pragma once
+
+#include "dial_decoder.h"
+
+#define DIAL_PROFILE_NAMESPACE "dial"
+
+// X(DialTiming field, NVS key, dial_config.h constant)
+#define DIAL_PROFILE_FIELDS(X) \
+  X(pulseDebounceUs, "pulse_db_us",     PULSE_DEBOUNCE_US) \
+  X(dialDebounceUs,  "dial_db_us",      DIAL_DEBOUNCE_US) \
+  X(timeoutUs,       "timeout_us",      DIAL_TIMEOUT_US) \
+  X(timeoutMinUs,    "timeout_min_us",  DIAL_TIMEOUT_MIN_US) \
+  X(timeoutPeriods,  "timeout_periods", DIAL_TIMEOUT_PERIODS)
+
+// Timing from NVS over the compiled-in defaults
+DialTiming dialProfileLoad();
@@ -0,0 +1,96 @@
+/*
+ * Edge Event Ring
+ *
+ * Lock-free single-producer/single-consumer ring buffer that carries raw,
+ * timestamped edge records from the GPIO interrupt handlers to loop().
+ *
+ * The interrupt handlers only push a few bytes and return; debouncing,
+ * digit decoding and all Serial output happen on the consumer side, so a
+ * slow or blocked serial port can never stall interrupt handling.
+ *
+ * Producer: the GPIO ISRs. Both pins are dispatched from the same GPIO
+ * interrupt vector and never nest, so they form a single producer.
+ * Consumer: loop().
+ *
+ * When the ring is full the new event is dropped and counted; the
+ * consumer reports the counter so lost edges are never silent.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Force inlining so push() lands in the caller's IRAM section
+#define RING_INLINE inline __attribute__((always_inline))
+
+// Edge sources
+#define EDGE_PULSE 0
+#define EDGE_SHUNT 1
+
+struct EdgeEvent {
+  uint64_t time;    // halMicros() when the edge was seen
+  uint8_t pin;      // EDGE_PULSE or EDGE_SHUNT
+  uint8_t level;    // Pin level read in the ISR (HIGH/LOW)
+};
+
+template <typename T, uint32_t SIZE>
+class SpscRing {
+  static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "Ring size must be a power of two");
+
+public:
+  // Producer side - returns false (and counts the drop) when full
+  RING_INLINE bool push(const T& item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    uint32_t used = head - tail;
+
+    if (used >= SIZE) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    buffer_[head & (SIZE - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+
+    if (used + 1 > highWater_.load(std::memory_order_relaxed)) {
+      highWater_.store(used + 1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Consumer side - returns false when empty
+  RING_INLINE bool pop(T& item) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+
+    if (tail == head) {
+      return false;
+    }
+
+    item = buffer_[tail & (SIZE - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+  }
+
+  uint32_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+  static constexpr uint32_t capacity() { return SIZE; }
+
+  // Overflow counters (written by the producer, read anywhere)
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  uint32_t highWater() const { return highWater_.load(std::memory_order_relaxed); }
+
+private:
+  T buffer_[SIZE];
+  std::atomic<uint32_t> head_{0};       // Next slot to write (producer)
+  std::atomic<uint32_t> tail_{0};       // Next slot to read (consumer)
+  std::atomic<uint32_t> dropped_{0};    // Events lost because the ring was full
+  std::atomic<uint32_t> highWater_{0};  // Peak fill level seen by the producer
+};
@@ -0,0 +1,385 @@
+/*
+ * Edge Trace - see edge_trace.h
+ */
+
+#include "edge_trace.h"
+#include "dial_config.h"
+#include "hal.h"
+#include "telemetry.h"
+#include <stdlib.h>
+#include <string.h>
+
+static_assert(EDGE_TRACE_BLOCK_BYTES >= 32 && EDGE_TRACE_BLOCK_BYTES <= 0xFFFF, "Trace block size out of range");
+
+static uint8_t* traceRing = nullptr;
+static size_t traceBlocks = 0;
+static size_t oldestBlock = 0;
+static size_t newestBlock = 0;
+static bool haveBlock = false;
+static uint64_t lastTime = 0;       // Time of the last edge recorded
+static uint32_t edgesHeld = 0;
+static uint32_t edgesLost = 0;      // Dropped with their block, the stage full, or no room during a dump
+
+// Edges wait here, raw and in internal RAM, until edgeTraceFlush() encodes
+// them: the GPIO ISR must not touch PSRAM or code in flash, which are both
+// out of reach while the cache is off (flash writes, e.g. NVS). The ISR and
+// the capture task both record, so pushes go under halEnterCritical().
+static SpscRing<EdgeEvent, EDGE_TRACE_STAGE_SIZE> traceStage;
+static uint32_t stageDropsSeen = 0;
+
+// Chunked dump in progress: the file is sent as the header, the blocks
+// held when it began (oldest first) and the CRC. Those blocks stay as they
+// are until sent: new edges go into fresh blocks, and are lost rather than
+// overwrite one still to be sent.
+enum DumpPiece : uint8_t { DUMP_IDLE, DUMP_HEADER, DUMP_BLOCKS, DUMP_TRAILER };
+static DumpPiece dumpPiece = DUMP_IDLE;
+static uint8_t dumpHeader[EDGE_TRACE_HEADER_SIZE];
+static uint8_t dumpTrailer[2];
+static size_t dumpNext = 0;        // Ring index of the block being sent
+static size_t dumpBlocksLeft = 0;  // Blocks still to send, that one included
+static size_t dumpOffset = 0;      // Bytes of the current piece sent
+static uint16_t dumpCrc = 0xFFFF;
+static bool sealed = false;        // Next edge starts a new block
+
+static inline uint8_t* blockAt(size_t index) {
+  return traceRing + index * EDGE_TRACE_BLOCK_BYTES;
+}
+
+static inline uint16_t get16(const uint8_t* in) {
+  return in[0] | (in[1] << 8);
+}
+
+static inline void put16(uint8_t* out, uint16_t value) {
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+}
+
+static void putLe(uint8_t* out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    out[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+static uint64_t getLe(const uint8_t* in, int bytes) {
+  uint64_t value = 0;
+  for (int i = bytes - 1; i >= 0; i--) {
+    value = (value << 8) | in[i];
+  }
+  return value;
+}
+
+// Signed delta folded into an unsigned one (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...):
+// RMT pulse edges are recorded after later shunt edges
+static inline uint64_t zigzag(int64_t delta) {
+  return ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+size_t edgeTraceBegin(size_t psramBytes, size_t ramBytes) {
+  size_t bytes = psramBytes;
+  traceRing = bytes ? (uint8_t*)halAllocExternal(bytes) : nullptr;
+  if (!traceRing) {
+    bytes = ramBytes;
+    traceRing = (uint8_t*)malloc(bytes);
+  }
+  traceBlocks = bytes / EDGE_TRACE_BLOCK_BYTES;
+  if (!traceRing || traceBlocks < 2) {
+    free(traceRing);
+    traceRing = nullptr;
+    return 0;
+  }
+  EdgeEvent edge;
+  while (traceStage.pop(edge)) {
+  }
+  stageDropsSeen = traceStage.dropped();
+  haveBlock = false;
+  edgesHeld = 0;
+  edgesLost = 0;
+  return traceBlocks * EDGE_TRACE_BLOCK_BYTES;
+}
+
+// True if block is one a running dump has still to send
+static bool dumpPending(size_t block) {
+  return dumpBlocksLeft && (block + traceBlocks - dumpNext) % traceBlocks < dumpBlocksLeft;
+}
+
+// Start the next block with a keyframe at time, dropping the oldest block
+// when the ring is full. Returns false if that block is still to be
+// dumped.
+static bool startBlock(uint64_t time) {
+  if (!haveBlock) {
+    haveBlock = true;
+    oldestBlock = newestBlock = 0;
+  } else {
+    size_t next = (newestBlock + 1) % traceBlocks;
+    if (next == oldestBlock) {
+      if (dumpPending(oldestBlock)) {
+        return false;
+      }
+      uint16_t dropped = get16(blockAt(oldestBlock) + 2);
+      edgesLost += dropped;
+      edgesHeld -= dropped;
+      oldestBlock = (oldestBlock + 1) % traceBlocks;
+    }
+    newestBlock = next;
+  }
+  sealed = false;
+  uint8_t* block = blockAt(newestBlock);
+  size_t used = EDGE_TRACE_BLOCK_HEADER_SIZE;
+  used += telemetryPutVarint(time, block + used, EDGE_TRACE_BLOCK_BYTES - used);
+  put16(block, (uint16_t)used);
+  put16(block + 2, 0);
+  lastTime = time;
+  return true;
+}
+
+static size_t encodeRecord(uint64_t delta, uint8_t pin, uint8_t level, uint8_t* out) {
+  out[0] = (uint8_t)((pin & 1) | ((level & 1) << 1) | ((delta & 0x1F) << 3));
+  if (delta < 0x20) {
+    return 1;
+  }
+  out[0] |= 0x04;
+  return 1 + telemetryPutVarint(delta >> 5, out + 1, 10);
+}
+
+void IRAM_ATTR edgeTraceRecord(uint64_t time, uint8_t pin, uint8_t level) {
+  if (!traceRing) {
+    return;
+  }
+  EdgeEvent edge = { time, pin, level };
+  halEnterCritical();
+  traceStage.push(edge);
+  halExitCritical();
+}
+
+// Append one edge to the newest block, starting a new block when it is
+// full. Only edgeTraceFlush() encodes, and only from loop(), so the blocks
+// need no lock and none of this has to be in IRAM.
+static void encodeEdge(uint64_t time, uint8_t pin, uint8_t level) {
+  uint8_t record[11];
+  size_t length = encodeRecord(zigzag((int64_t)(time - lastTime)), pin, level, record);
+  uint8_t* block = blockAt(newestBlock);
+  if (!haveBlock || sealed || get16(block) + length > EDGE_TRACE_BLOCK_BYTES) {
+    if (!startBlock(time)) {
+      edgesLost++;
+      return;
+    }
+    block = blockAt(newestBlock);
+    length = encodeRecord(0, pin, level, record);
+  }
+  uint16_t used = get16(block);
+  memcpy(block + used, record, length);
+  put16(block, (uint16_t)(used + length));
+  put16(block + 2, get16(block + 2) + 1);
+  lastTime = time;
+  edgesHeld++;
+}
+
+void edgeTraceFlush() {
+  if (!traceRing) {
+    return;
+  }
+  EdgeEvent edge;
+  while (traceStage.pop(edge)) {
+    encodeEdge(edge.time, edge.pin, edge.level);
+  }
+  
+  // Edges the stage had no room for
+  uint32_t dropped = traceStage.dropped();
+  edgesLost += dropped - stageDropsSeen;
+  stageDropsSeen = dropped;
+}
+
+size_t edgeTraceCapacity() {
+  return traceRing ? traceBlocks * EDGE_TRACE_BLOCK_BYTES : 0;
+}
+
+size_t edgeTraceCount() {
+  return edgesHeld;
+}
+
+static size_t heldBlocks() {
+  return haveBlock ? (newestBlock + traceBlocks - oldestBlock) % traceBlocks + 1 : 0;
+}
+
+size_t edgeTraceBytes() {
+  size_t bytes = 0;
+  for (size_t i = 0; i < heldBlocks(); i++) {
+    bytes += get16(blockAt((oldestBlock + i) % traceBlocks));
+  }
+  return bytes;
+}
+
+size_t edgeTraceDumpBegin(uint64_t now) {
+  edgeTraceFlush();
+  size_t blocks = heldBlocks();
+  memcpy(dumpHeader, EDGE_TRACE_MAGIC, 4);
+  dumpHeader[4] = EDGE_TRACE_VERSION;
+  dumpHeader[5] = 0;
+  put16(dumpHeader + 6, EDGE_TRACE_BLOCK_BYTES);
+  putLe(dumpHeader + 8, edgesHeld, 4);
+  putLe(dumpHeader + 12, edgesLost, 4);
+  putLe(dumpHeader + 16, now, 8);
+  putLe(dumpHeader + 24, blocks, 4);
+  dumpPiece = DUMP_HEADER;
+  dumpNext = oldestBlock;
+  dumpBlocksLeft = blocks;
+  dumpOffset = 0;
+  dumpCrc = 0xFFFF;
+  sealed = true;
+  return sizeof(dumpHeader) + edgeTraceBytes() + sizeof(dumpTrailer);
+}
+
+size_t edgeTraceDumpStep(EdgeTraceWriter write, size_t maxBytes) {
+  size_t written = 0;
+  while (dumpPiece != DUMP_IDLE && written < maxBytes) {
+    const uint8_t* piece = dumpPiece == DUMP_HEADER ? dumpHeader
+                         : dumpPiece == DUMP_BLOCKS ? blockAt(dumpNext) : dumpTrailer;
+    size_t length = dumpPiece == DUMP_HEADER ? sizeof(dumpHeader)
+                  : dumpPiece == DUMP_BLOCKS ? get16(piece) : sizeof(dumpTrailer);
+    size_t chunk = length - dumpOffset < maxBytes - written ? length - dumpOffset : maxBytes - written;
+    if (dumpPiece != DUMP_TRAILER) {
+      dumpCrc = telemetryCrc16(piece + dumpOffset, chunk, dumpCrc);
+    }
+    write(piece + dumpOffset, chunk);
+    written += chunk;
+    dumpOffset += chunk;
+    if (dumpOffset < length) {
+      continue;
+    }
+    
+    // Piece sent: blocks go out straight from the ring, then the CRC
+    dumpOffset = 0;
+    if (dumpPiece == DUMP_BLOCKS) {
+      dumpNext = (dumpNext + 1) % traceBlocks;
+      dumpBlocksLeft--;
+    }
+    if (dumpPiece == DUMP_TRAILER) {
+      dumpPiece = DUMP_IDLE;
+    } else if (dumpBlocksLeft) {
+      dumpPiece = DUMP_BLOCKS;
+    } else {
+      put16(dumpTrailer, dumpCrc);
+      dumpPiece = DUMP_TRAILER;
+    }
+  }
+  return written;
+}
+
+bool edgeTraceDumping() {
+  return dumpPiece != DUMP_IDLE;
+}
+
+size_t edgeTraceDump(EdgeTraceWriter write, uint64_t now) {
+  size_t bytes = edgeTraceDumpBegin(now);
+  while (edgeTraceDumpStep(write, EDGE_TRACE_BLOCK_BYTES)) {
+  }
+  return bytes;
+}
+
+// Move on within the block, or to the next block or the CRC once it is used up
+void EdgeTraceReader::startBlock() {
+  if (blockLeft_ > 0) {
+    state_ = STATE_RECORD;
+    return;
+  }
+  have_ = 0;
+  state_ = --blocksLeft_ ? STATE_BLOCK : STATE_CRC;
+}
+
+bool EdgeTraceReader::feed(uint8_t byte, EdgeEvent& edge) {
+  if (state_ == STATE_DONE || state_ == STATE_ERROR) {
+    return false;
+  }
+  if (state_ != STATE_CRC) {
+    crc_ = telemetryCrc16(&byte, 1, crc_);
+  }
+  
+  switch (state_) {
+    case STATE_HEADER:
+      header_[have_++] = byte;
+      if (have_ == 4 && memcmp(header_, EDGE_TRACE_MAGIC, 4) != 0) {
+        state_ = STATE_ERROR;
+      } else if (have_ == EDGE_TRACE_HEADER_SIZE) {
+        if (header_[4] != EDGE_TRACE_VERSION) {
+          state_ = STATE_ERROR;
+          return false;
+        }
+        edgeCount_ = (uint32_t)getLe(header_ + 8, 4);
+        lost_ = (uint32_t)getLe(header_ + 12, 4);
+        dumpTime_ = getLe(header_ + 16, 8);
+        blocksLeft_ = (uint32_t)getLe(header_ + 24, 4);
+        have_ = 0;
+        state_ = blocksLeft_ ? STATE_BLOCK : STATE_CRC;
+      }
+      return false;
+      
+    case STATE_BLOCK:
+      header_[have_++] = byte;
+      if (have_ == EDGE_TRACE_BLOCK_HEADER_SIZE) {
+        size_t length = get16(header_);
+        if (length <= EDGE_TRACE_BLOCK_HEADER_SIZE) {
+          state_ = STATE_ERROR;
+          return false;
+        }
+        blockLeft_ = length - EDGE_TRACE_BLOCK_HEADER_SIZE;
+        value_ = 0;
+        shift_ = 0;
+        state_ = STATE_KEYFRAME;
+      }
+      return false;
+      
+    case STATE_RECORD:
+      blockLeft_--;
+      record_ = byte;
+      if (byte & 0x04) {
+        value_ = 0;
+        shift_ = 0;
+        state_ = STATE_DELTA;
+        return false;
+      }
+      value_ = 0;
+      break;
+      
+    case STATE_KEYFRAME:
+    case STATE_DELTA:
+      if (blockLeft_ == 0 || shift_ > 63) {
+        state_ = STATE_ERROR;
+        return false;
+      }
+      blockLeft_--;
+      value_ |= (uint64_t)(byte & 0x7F) << shift_;
+      shift_ += 7;
+      if (byte & 0x80) {
+        return false;
+      }
+      if (state_ == STATE_KEYFRAME) {
+        time_ = value_;
+        startBlock();
+        return false;
+      }
+      break;
+      
+    case STATE_CRC:
+      fileCrc_ |= (uint16_t)(byte << (8 * have_++));
+      if (have_ == 2) {
+        crcOk_ = fileCrc_ == crc_;
+        state_ = STATE_DONE;
+      }
+      return false;
+      
+    default:
+      return false;
+  }
+  
+  // A record is complete: value_ holds the delta bits above the first five
+  time_ += unzigzag((value_ << 5) | (record_ >> 3));
+  edge.time = time_;
+  edge.pin = record_ & 1;
+  edge.level = (record_ >> 1) & 1;
+  startBlock();
+  return true;
+}
@@ -0,0 +1,132 @@
+/*
+ * Edge Trace
+ *
+ * Flight recorder for raw dial edges: every edge the ISR sees on either
+ * pin, before any debouncing or settle voting, is stored with its
+ * microsecond timestamp in a large ring (PSRAM when fitted). When the ring
+ * is full the oldest edges are overwritten, so it can stay on in
+ * production and always holds the latest stretch of dialing.
+ *
+ * edgeTraceRecord() only copies the edge into a small staging ring in
+ * internal RAM, so it is safe in an IRAM interrupt handler while the flash
+ * cache is off. edgeTraceFlush(), run from loop() by dialInputProcess(),
+ * moves staged edges into the ring; all compression happens there, out of
+ * interrupt context. Edges that find the staging ring full
+ * are counted as lost.
+ *
+ * With the RMT capture the pulse edges are recorded from each frame, with
+ * no bounce filtering, when the frame arrives; with the PCNT counter the
+ * pulse line has no edges to record.
+ *
+ * Edges are stored compressed, in blocks of EDGE_TRACE_BLOCK_BYTES. A
+ * block starts with a keyframe (absolute time) and then holds one record
+ * per edge: a byte with pin, level and the low 5 bits of the time since
+ * the previous edge, followed by the rest of that delta as a varint when
+ * it does not fit. Dial edges are milliseconds apart, so an edge takes 2-3
+ * bytes. Blocks decode independently: the ring drops the oldest block as
+ * a whole, and a reader can start at any block.
+ *
+ * A dump writes the ring out in the trace file format:
+ *
+ *   offset  size  field (little endian, varint = unsigned LEB128)
+ *   0       4     magic "DTRC"
+ *   4       1     version, 2
+ *   5       1     reserved, 0
+ *   6       2     block size in the recorder
+ *   8       4     edge count
+ *   12      4     edges lost: overwritten, staging ring full, or no room
+ *                 during a dump
+ *   16      8     dump time, us since boot
+ *   24      4     block count
+ *   28      ...   blocks, oldest first, each:
+ *                   2  block length in bytes, these 4 header bytes included
+ *                   2  edges in the block
+ *                   varint keyframe time, us since boot
+ *                   records: byte pin (bit 0, 0 = pulse, 1 = shunt) |
+ *                   level (bit 1) | more (bit 2) | delta bits 0-4 (bits
+ *                   3-7), then varint delta >> 5 if more is set. The
+ *                   delta to the previous edge (the keyframe for the
+ *                   first) is zigzag coded: 0, -1, 1, -2 -> 0, 1, 2, 3
+ *   end     2     CRC-16/CCITT-FALSE of all bytes before it
+ *
+ * Within the file edges are in recording order, which is time order per
+ * pin; readers sort by time. EdgeTraceReader decodes a dump as a stream,
+ * and "program trace" turns one into a script for "program script".
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "edge_ring.h"
+
+#define EDGE_TRACE_MAGIC "DTRC"
+#define EDGE_TRACE_VERSION 2
+#define EDGE_TRACE_HEADER_SIZE 28
+#define EDGE_TRACE_BLOCK_HEADER_SIZE 4
+
+// Allocate the ring: psramBytes of PSRAM if possible, else ramBytes of
+// internal RAM. Returns the bytes allocated, 0 if nothing could be
+// allocated (tracing then stays off).
+size_t edgeTraceBegin(size_t psramBytes, size_t ramBytes);
+
+// Record one raw edge (any context, IRAM-safe)
+void edgeTraceRecord(uint64_t time, uint8_t pin, uint8_t level);
+
+// Move staged edges into the ring (loop() context; dumps flush first)
+void edgeTraceFlush();
+
+// Dump the ring as a trace file, a piece at a time so loop() can go on
+// decoding and recording in between. edgeTraceDumpBegin() fixes what the
+// file holds and returns its size in bytes; each edgeTraceDumpStep()
+// writes up to maxBytes more through write() and returns how many it
+// wrote. Edges recorded meanwhile go into new blocks; once those would
+// overwrite a block still to be sent, they are counted as lost.
+typedef void (*EdgeTraceWriter)(const uint8_t* data, size_t length);
+size_t edgeTraceDumpBegin(uint64_t now);
+size_t edgeTraceDumpStep(EdgeTraceWriter write, size_t maxBytes);
+bool edgeTraceDumping();
+
+// Whole dump in one call; returns the bytes written
+size_t edgeTraceDump(EdgeTraceWriter write, uint64_t now);
+
+size_t edgeTraceCapacity();   // Bytes
+size_t edgeTraceCount();      // Edges currently held
+size_t edgeTraceBytes();      // Bytes currently used by them
+
+// Streaming decoder for a trace file. Feed bytes in order from the magic
+// on; feed() returns true each time it completes an edge. Check ok() once
+// finished() to know the CRC matched.
+class EdgeTraceReader {
+public:
+  bool feed(uint8_t byte, EdgeEvent& edge);
+
+  bool finished() const { return state_ == STATE_DONE; }
+  bool failed() const { return state_ == STATE_ERROR; }
+  bool ok() const { return finished() && crcOk_; }
+  uint32_t edgeCount() const { return edgeCount_; }
+  uint32_t lost() const { return lost_; }
+  uint64_t dumpTime() const { return dumpTime_; }
+
+private:
+  enum State : uint8_t { STATE_HEADER, STATE_BLOCK, STATE_KEYFRAME, STATE_RECORD, STATE_DELTA,
+                         STATE_CRC, STATE_DONE, STATE_ERROR };
+
+  void startBlock();
+
+  State state_ = STATE_HEADER;
+  uint8_t header_[EDGE_TRACE_HEADER_SIZE];
+  size_t have_ = 0;            // Bytes collected of the current fixed-size field
+  uint16_t crc_ = 0xFFFF;
+  uint16_t fileCrc_ = 0;
+  bool crcOk_ = false;
+  uint32_t edgeCount_ = 0;
+  uint32_t lost_ = 0;
+  uint64_t dumpTime_ = 0;
+  uint32_t blocksLeft_ = 0;
+  size_t blockLeft_ = 0;       // Body bytes left in the current block
+  uint64_t value_ = 0;         // Varint being assembled
+  int shift_ = 0;
+  uint64_t time_ = 0;          // Time of the previous edge
+  uint8_t record_ = 0;         // First byte of the record being read
+};
@@ -0,0 +1,70 @@
+/*
+ * Hardware Abstraction Layer
+ *
+ * Thin wrapper over the handful of Arduino calls the dial input path needs
+ * (pin reads, time, interrupt registration, waking the consumer). The ESP32 build maps these
+ * straight onto the Arduino core (hal_arduino.cpp); the native build
+ * (host/hal_native.cpp) replaces them with scripted pins and a virtual
+ * microsecond clock so the same decoder code can run on a developer machine.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#endif
+
+typedef void (*HalIsr)();
+
+uint64_t halMicros();   // Microseconds since boot
+int halDigitalRead(uint8_t pin);
+uint32_t halReadInputs();   // Levels of GPIO 0-31 from a single register read
+void halPinInputPullup(uint8_t pin);
+// Any edge on the GPIOs in pinMask (0-31) runs isr, once per interrupt
+// however many of them changed: the ESP32 build registers its own GPIO
+// interrupt handler instead of the per-pin Arduino dispatcher
+void halAttachPinsInterrupt(uint32_t pinMask, HalIsr isr);
+
+// Consumer wake-up: the task that calls halBindConsumer() sleeps in
+// halWaitForWork() until an ISR calls halNotifyFromIsr(), another task
+// calls halNotifyConsumer(), or the one-shot timeout armed with
+// halArmTimeout() expires.
+void halBindConsumer();
+void halNotifyFromIsr();
+void halNotifyConsumer();
+void halWaitForWork();
+void halArmTimeout(uint64_t delayUs);
+void halCancelTimeout();
+
+// Settle timer: a second one-shot timer whose callback runs outside the
+// edge ISR (deferred settle sampling). halArmSettle() may be called from
+// an ISR and restarts the timer if it is already running.
+void halBindSettleCallback(HalIsr callback);
+void halArmSettle(uint64_t delayUs);
+
+// Short critical section shared by ISRs and timer callbacks
+void halEnterCritical();
+void halExitCritical();
+
+// Allocate from external RAM (PSRAM); nullptr if there is none or it is full
+void* halAllocExternal(size_t bytes);
+
+// Stored setting (NVS namespace group); fallback if it is not set. The
+// native build has no store and always returns fallback.
+uint32_t halLoadSetting(const char* group, const char* key, uint32_t fallback);
+
+#ifndef ARDUINO
+// Native-only hooks used by host tools to drive the HAL
+void hostSetMicros(uint64_t now);
+void hostSetPin(uint8_t pin, int level);  // Fires the pin's ISR on a level change
+void hostAttachPeripheral(uint8_t pin, HalIsr watcher);  // Emulated hardware watching a pin
+void hostArmPeripheralTimer(uint64_t at, HalIsr callback);  // Its one-shot timer, counted as an interrupt
+uint32_t hostIsrCount();   // Interrupts fired so far
+#endif
@@ -0,0 +1,145 @@
+/*
+ * HAL - Arduino/ESP32 implementation
+ */
+
+#include "hal.h"
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include <esp_heap_caps.h>
+#include <soc/gpio_reg.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static TaskHandle_t consumerTask = nullptr;
+static esp_timer_handle_t timeoutTimer = nullptr;
+static esp_timer_handle_t settleTimer = nullptr;
+static HalIsr settleCallback = nullptr;
+static portMUX_TYPE halMux = portMUX_INITIALIZER_UNLOCKED;
+
+uint64_t IRAM_ATTR halMicros() {
+  return esp_timer_get_time();  // 64-bit, IRAM-safe, never wraps in practice
+}
+
+int IRAM_ATTR halDigitalRead(uint8_t pin) {
+  return digitalRead(pin);
+}
+
+uint32_t IRAM_ATTR halReadInputs() {
+  return REG_READ(GPIO_IN_REG);
+}
+
+void halPinInputPullup(uint8_t pin) {
+  pinMode(pin, INPUT_PULLUP);
+}
+
+static HalIsr pinsIsr = nullptr;
+static uint32_t pinsMask = 0;
+static intr_handle_t pinsHandle = nullptr;
+
+// The one GPIO interrupt entry: acknowledge every pending pin, then run
+// the handler once, which reads all levels itself
+static void IRAM_ATTR onPinsInterrupt(void*) {
+  uint32_t status = REG_READ(GPIO_STATUS_REG) & pinsMask;
+  REG_WRITE(GPIO_STATUS_W1TC_REG, status);
+  if (status) {
+    pinsIsr();
+  }
+}
+
+void halAttachPinsInterrupt(uint32_t pinMask, HalIsr isr) {
+  pinsIsr = isr;
+  pinsMask = pinMask;
+  for (int pin = 0; pin < 32; pin++) {
+    if (pinMask & (1UL << pin)) {
+      gpio_set_intr_type((gpio_num_t)pin, GPIO_INTR_ANYEDGE);
+      gpio_intr_enable((gpio_num_t)pin);
+    }
+  }
+  // Takes over the GPIO interrupt, so attachInterrupt() must not be used
+  if (!pinsHandle) {
+    gpio_isr_register(onPinsInterrupt, nullptr, ESP_INTR_FLAG_IRAM, &pinsHandle);
+  }
+}
+
+static void onTimeoutTimer(void*) {
+  xTaskNotifyGive(consumerTask);
+}
+
+void halBindConsumer() {
+  consumerTask = xTaskGetCurrentTaskHandle();
+  
+  if (!timeoutTimer) {
+    esp_timer_create_args_t args = {};
+    args.callback = onTimeoutTimer;
+    args.name = "dial_timeout";
+    esp_timer_create(&args, &timeoutTimer);
+  }
+}
+
+void IRAM_ATTR halNotifyFromIsr() {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(consumerTask, &woken);
+  if (woken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+void halNotifyConsumer() {
+  xTaskNotifyGive(consumerTask);
+}
+
+void halWaitForWork() {
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);  // No wakeups at all while idle
+}
+
+void halArmTimeout(uint64_t delayUs) {
+  esp_timer_stop(timeoutTimer);  // Harmless if not running
+  esp_timer_start_once(timeoutTimer, delayUs);
+}
+
+void halCancelTimeout() {
+  esp_timer_stop(timeoutTimer);
+}
+
+static void onSettleTimer(void*) {
+  settleCallback();
+}
+
+void halBindSettleCallback(HalIsr callback) {
+  settleCallback = callback;
+  
+  if (!settleTimer) {
+    esp_timer_create_args_t args = {};
+    args.callback = onSettleTimer;
+    args.name = "dial_settle";
+    esp_timer_create(&args, &settleTimer);
+  }
+}
+
+void IRAM_ATTR halArmSettle(uint64_t delayUs) {
+  esp_timer_stop(settleTimer);  // esp_timer start/stop are IRAM-safe
+  esp_timer_start_once(settleTimer, delayUs);
+}
+
+void IRAM_ATTR halEnterCritical() {
+  portENTER_CRITICAL_SAFE(&halMux);
+}
+
+void IRAM_ATTR halExitCritical() {
+  portEXIT_CRITICAL_SAFE(&halMux);
+}
+
+void* halAllocExternal(size_t bytes) {
+  return heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+}
+
+uint32_t halLoadSetting(const char* group, const char* key, uint32_t fallback) {
+  Preferences preferences;
+  if (!preferences.begin(group, true)) {
+    return fallback;   // Namespace never written
+  }
+  uint32_t value = preferences.getUInt(key, fallback);
+  preferences.end();
+  return value;
+}
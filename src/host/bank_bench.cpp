@@ -0,0 +1,204 @@
+/*
+ * Dial bank benchmark
+ *
+ * Renders simulated dialing on 32 lines into 1 ms sample words, then
+ * measures the cost per sample of decoding 1, 8 and 32 of those lines:
+ *
+ *   bank     - DialBank, vertical-counter debounce and bit-sliced counts
+ *   per-pin  - one DialDecoder per line, called for every sampled edge the
+ *              way the per-pin CHANGE handlers would be (handler work only;
+ *              interrupt entry/exit per edge comes on top on the target)
+ *
+ * and then the bulk kernel on synthetic DMA buffers of bus samples, 8 lines
+ * in uint16_t samples (the S3's camera port, see bus_capture.h) and 16 in
+ * uint32_t, against DialBank::sample() fed the same samples one by one.
+ *
+ *   program bank-bench [seconds] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "dial_bank.h"
+#include "dial_config.h"
+#include "dial_decoder.h"
+#include "dial_sim.h"
+#include "host_tools.h"
+
+#define BENCH_SAMPLE_US 1000
+
+struct SampleStream {
+  std::vector<uint32_t> pulse;
+  std::vector<uint32_t> shunt;
+  long dialed = 0;
+};
+
+// Dial random digits with random pauses on each line and sample the levels
+static void renderLines(SampleStream& stream, size_t samples, uint64_t seed) {
+  stream.pulse.assign(samples, 0);
+  stream.shunt.assign(samples, 0);
+  
+  SimParams params;
+  std::vector<SimEdge> edges;
+  
+  for (int line = 0; line < DIAL_BANK_LINES; line++) {
+    DialSimulator simulator(params, seed * 1000 + line);
+    uint32_t bit = 1UL << line;
+    uint64_t nextDigitUs = (uint64_t)simulator.random().uniform(0, 2e6);
+    size_t next = 0;
+    uint32_t pulseLevel = 0;   // At rest: pulse closed, shunt HIGH
+    uint32_t shuntLevel = 1;
+    edges.clear();
+    
+    for (size_t s = 0; s < samples; s++) {
+      uint64_t now = (uint64_t)s * BENCH_SAMPLE_US;
+      
+      // Queue the next digit once the previous one has played out
+      if (next == edges.size() && now >= nextDigitUs) {
+        edges.clear();
+        next = 0;
+        uint64_t end = simulator.generateDigit(simulator.random().below(10), now, edges);
+        nextDigitUs = end + (uint64_t)simulator.random().uniform(0.5e6, 2e6);
+        if (end < (uint64_t)samples * BENCH_SAMPLE_US) {
+          stream.dialed++;
+        }
+      }
+      
+      while (next < edges.size() && edges[next].timeUs <= now) {
+        (edges[next].pin == EDGE_PULSE ? pulseLevel : shuntLevel) = edges[next].level;
+        next++;
+      }
+      
+      if (pulseLevel) stream.pulse[s] |= bit;
+      if (shuntLevel) stream.shunt[s] |= bit;
+    }
+  }
+}
+
+static double benchBank(const SampleStream& stream, int lines, long& digits) {
+  uint32_t mask = (lines >= 32) ? 0xFFFFFFFF : ((1UL << lines) - 1);
+  DialBank bank;
+  digits = 0;
+  
+  auto start = std::chrono::steady_clock::now();
+  for (size_t s = 0; s < stream.pulse.size(); s++) {
+    // Unused lines read as idle (pulse LOW, shunt HIGH)
+    uint32_t completed = bank.sample(stream.pulse[s] & mask, stream.shunt[s] | ~mask);
+    while (completed) {
+      int line = __builtin_ctz(completed);
+      completed &= completed - 1;
+      digits += bank.pulses(line) > 0;
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  return seconds * 1e9 / stream.pulse.size();
+}
+
+static double benchPerPin(const SampleStream& stream, int lines, long& digits, long& edges) {
+  std::vector<DialDecoder> decoders(lines);
+  uint32_t mask = (lines >= 32) ? 0xFFFFFFFF : ((1UL << lines) - 1);
+  uint32_t lastPulse = 0;
+  uint32_t lastShunt = mask;
+  digits = 0;
+  edges = 0;
+  
+  auto start = std::chrono::steady_clock::now();
+  for (size_t s = 0; s < stream.pulse.size(); s++) {
+    uint64_t now = (uint64_t)s * BENCH_SAMPLE_US;
+    uint32_t pulse = stream.pulse[s] & mask;
+    uint32_t shunt = stream.shunt[s] & mask;
+    
+    // One handler call per pin edge, as the CHANGE interrupts would make
+    uint32_t changed = pulse ^ lastPulse;
+    while (changed) {
+      int line = __builtin_ctz(changed);
+      changed &= changed - 1;
+      decoders[line].pulseEdge(now, (pulse >> line) & 1);
+      edges++;
+    }
+    changed = shunt ^ lastShunt;
+    while (changed) {
+      int line = __builtin_ctz(changed);
+      changed &= changed - 1;
+      DialEvent event = decoders[line].shuntEdge(now, (shunt >> line) & 1);
+      edges++;
+      if (event.type == DIAL_EVENT_RESTED && event.pulses > 0) {
+        digits++;
+      }
+    }
+    lastPulse = pulse;
+    lastShunt = shunt;
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  return seconds * 1e9 / stream.pulse.size();
+}
+
+static void countDigit(int, int pulses, void* context) {
+  *(long*)context += pulses > 0;
+}
+
+// Pack the first lines of the stream into bus samples: pulse contacts in
+// the low half, shunt contacts in the high half
+template <typename Sample>
+static std::vector<Sample> packBus(const SampleStream& stream) {
+  const int lines = sizeof(Sample) * 4;
+  const uint32_t mask = (uint32_t)((1ULL << lines) - 1);
+  std::vector<Sample> bus(stream.pulse.size());
+  for (size_t s = 0; s < bus.size(); s++) {
+    bus[s] = (Sample)((stream.pulse[s] & mask) | ((uint64_t)(stream.shunt[s] & mask) << lines));
+  }
+  return bus;
+}
+
+template <typename Sample>
+static double benchBlock(const std::vector<Sample>& bus, long& digits) {
+  DialBank bank;
+  digits = 0;
+  
+  auto start = std::chrono::steady_clock::now();
+  for (size_t s = 0; s < bus.size(); s += DIAL_BUS_BUFFER_SAMPLES) {
+    size_t count = std::min((size_t)DIAL_BUS_BUFFER_SAMPLES, bus.size() - s);
+    bank.sampleBlock(&bus[s], count, countDigit, &digits);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  return seconds * 1e9 / bus.size();
+}
+
+int runBankBench(int argc, char** argv) {
+  double seconds = argc > 0 ? atof(argv[0]) : 600;
+  uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1;
+  size_t samples = (size_t)(seconds * 1e6 / BENCH_SAMPLE_US);
+  
+  SampleStream stream;
+  renderLines(stream, samples, seed);
+  printf("%zu samples (%.0f s at %d us), %ld digits dialed on %d lines\n\n",
+         samples, seconds, BENCH_SAMPLE_US, stream.dialed, DIAL_BANK_LINES);
+  
+  // The per-pin figure is handler work only; on the target every edge
+  // also pays a full interrupt entry and exit on top of it.
+  printf("lines  bank ns/sample  digits   per-pin ns/sample  digits  interrupts/s\n");
+  const int lineCounts[] = { 1, 8, 32 };
+  for (int lines : lineCounts) {
+    long bankDigits = 0, perPinDigits = 0, edges = 0;
+    double bankNs = benchBank(stream, lines, bankDigits);
+    double perPinNs = benchPerPin(stream, lines, perPinDigits, edges);
+    printf("%5d  %14.2f  %6ld   %17.2f  %6ld  %12.1f\n",
+           lines, bankNs, bankDigits, perPinNs, perPinDigits, edges / seconds);
+  }
+  
+  printf("\nbus lines  sample ns/sample  digits   block ns/sample  digits  (%d-sample buffers)\n",
+         DIAL_BUS_BUFFER_SAMPLES);
+  long sampleDigits = 0, blockDigits = 0;
+  double sampleNs = benchBank(stream, 8, sampleDigits);
+  double blockNs = benchBlock(packBus<uint16_t>(stream), blockDigits);
+  printf("%9d  %16.2f  %6ld   %15.2f  %6ld\n", 8, sampleNs, sampleDigits, blockNs, blockDigits);
+  sampleNs = benchBank(stream, 16, sampleDigits);
+  blockNs = benchBlock(packBus<uint32_t>(stream), blockDigits);
+  printf("%9d  %16.2f  %6ld   %15.2f  %6ld\n", 16, sampleNs, sampleDigits, blockNs, blockDigits);
+  return 0;
+}
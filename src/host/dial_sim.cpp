@@ -0,0 +1,109 @@
+/*
+ * Dial Waveform Simulator - see dial_sim.h
+ */
+
+#include "dial_sim.h"
+#include <algorithm>
+
+// Emit a contact transition at timeUs, including any bounce, and return
+// the time the line settled at its new level
+uint64_t DialSimulator::transition(uint64_t timeUs, uint8_t pin, uint8_t level, std::vector<SimEdge>& edges) {
+  edges.push_back({ timeUs, pin, level });
+  
+  int bounces = params_.bounceMax > 0 ? random_.below(params_.bounceMax + 1) : 0;
+  uint64_t windowUs = (uint64_t)(params_.bounceMs * 1000.0);
+  uint64_t t = timeUs;
+  for (int i = 0; i < bounces && windowUs > 0; i++) {
+    // Each bounce pair briefly returns to the old level, spread over the window
+    uint64_t step = windowUs / (2 * bounces);
+    t += 1 + random_.next() % (step ? step : 1);
+    edges.push_back({ t, pin, (uint8_t)!level });
+    t += 1 + random_.next() % (step ? step : 1);
+    edges.push_back({ t, pin, level });
+  }
+  return t;
+}
+
+uint64_t DialSimulator::generateDigit(int digit, uint64_t startUs, std::vector<SimEdge>& edges) {
+  int pulses = (digit == 0) ? 10 : digit;
+  size_t first = edges.size();   // This digit's edges start here
+  
+  double speed = params_.pulsesPerSecond * (1.0 + random_.uniform(-params_.speedSpread, params_.speedSpread));
+  double periodUs = 1e6 / speed;
+  
+  // Shunt opens as the finger starts winding the dial (a stuck shunt only
+  // the first time - it then stays open without further contact bounce)
+  uint64_t t = startUs;
+  if (!shuntOpen_ && !params_.shuntMissing) {
+    t = transition(startUs, EDGE_SHUNT, 0, edges);
+    shuntOpen_ = params_.shuntStuck;
+  }
+  t += (uint64_t)(random_.uniform(params_.windupMinMs, params_.windupMaxMs) * 1000.0);
+  
+  for (int i = 0; i < pulses; i++) {
+    double pulseUs = periodUs * (1.0 + random_.uniform(-params_.jitter, params_.jitter));
+    uint64_t breakUs = (uint64_t)(pulseUs * params_.breakRatio);
+    uint64_t makeUs = (uint64_t)pulseUs - breakUs;
+    
+    if (params_.dropRate > 0 && random_.uniform() < params_.dropRate) {
+      t += (uint64_t)pulseUs;   // Dirty contact: this pulse never breaks
+      continue;
+    }
+    
+    transition(t, EDGE_PULSE, 1, edges);   // Break
+    if (params_.splitRate > 0 && random_.uniform() < params_.splitRate) {
+      // Contact re-makes for a moment in the middle of the break
+      transition(t + breakUs * 2 / 5, EDGE_PULSE, 0, edges);
+      transition(t + breakUs * 3 / 5, EDGE_PULSE, 1, edges);
+    }
+    t += breakUs;
+    transition(t, EDGE_PULSE, 0, edges);   // Make
+    t += makeUs;
+  }
+  
+  // Noise spikes: the pulse line briefly flips away from its current level
+  if (params_.spikesPerDigit > 0) {
+    uint64_t firstPulse = startUs, lastPulse = t;
+    for (size_t i = first; i < edges.size(); i++) {
+      if (edges[i].pin == EDGE_PULSE) {
+        firstPulse = edges[i].timeUs;
+        break;
+      }
+    }
+    int spikes = (int)(params_.spikesPerDigit * 2 * random_.uniform() + 0.5);
+    for (int i = 0; i < spikes; i++) {
+      uint64_t at = firstPulse + (uint64_t)(random_.uniform() * (lastPulse - firstPulse));
+      uint64_t until = at + (uint64_t)params_.spikeUs;
+      uint8_t level = 0;
+      uint64_t levelTime = 0;
+      bool clear = true;   // Keep spikes off real transitions and each other
+      for (size_t e = first; e < edges.size(); e++) {
+        const SimEdge& edge = edges[e];
+        if (edge.pin != EDGE_PULSE) {
+          continue;
+        }
+        if (edge.timeUs + 1000 >= at && edge.timeUs <= until + 1000) {
+          clear = false;
+        } else if (edge.timeUs <= at && edge.timeUs >= levelTime) {
+          level = edge.level;
+          levelTime = edge.timeUs;
+        }
+      }
+      if (clear) {
+        edges.push_back({ at, EDGE_PULSE, (uint8_t)!level });
+        edges.push_back({ until, EDGE_PULSE, level });
+      }
+    }
+  }
+  
+  // Shunt closes a little after the last make as the dial comes to rest
+  t += (uint64_t)(random_.uniform(params_.restSkewMinMs, params_.restSkewMaxMs) * 1000.0);
+  if (!params_.shuntStuck && !params_.shuntMissing) {
+    t = transition(t, EDGE_SHUNT, 1, edges);
+  }
+  
+  // Spikes, splits and bounce tails land between edges already emitted
+  std::stable_sort(edges.begin() + first, edges.end(),
+                   [](const SimEdge& a, const SimEdge& b) { return a.timeUs < b.timeUs; });
+  return t;
+}
@@ -0,0 +1,84 @@
+/*
+ * Dial Waveform Simulator
+ *
+ * Generates realistic pulse/shunt edge sequences for dialed digits on a
+ * virtual microsecond time line: configurable dial speed, make/break
+ * ratio, per-pulse jitter, contact bounce, shunt/pulse skew and injected
+ * contact faults (missed and split pulses, noise spikes). Output is
+ * fully deterministic for a given seed so runs can be compared exactly.
+ *
+ * Line levels follow the firmware's wiring: at rest the pulse contact is
+ * closed (LOW) and the shunt contact is HIGH. The shunt goes LOW while
+ * the dial is off-normal, and each pulse is a break (pulse HIGH).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "edge_ring.h"
+
+struct SimEdge {
+  uint64_t timeUs;
+  uint8_t pin;      // EDGE_PULSE or EDGE_SHUNT
+  uint8_t level;
+};
+
+struct SimParams {
+  double pulsesPerSecond = 10.0;   // Nominal dial speed (10 or 20 pps)
+  double breakRatio = 0.6;         // Fraction of each pulse period spent open
+  double jitter = 0.03;            // Per-pulse period variation (+/- fraction)
+  double speedSpread = 0.05;       // Per-digit dial speed variation (+/- fraction)
+  double bounceMs = 2.0;           // Window after each transition that may bounce
+  int bounceMax = 2;               // Max bounce pairs per transition
+  double windupMinMs = 200.0;      // Shunt open to first pulse (finger wind-up)
+  double windupMaxMs = 600.0;
+  double restSkewMinMs = 20.0;     // Last pulse to shunt closing
+  double restSkewMaxMs = 80.0;
+  bool shuntStuck = false;         // Shunt opens once and never closes again
+  bool shuntMissing = false;       // No shunt wired: the line never moves
+  double dropRate = 0.0;           // Chance a pulse never opens the contact
+  double splitRate = 0.0;          // Chance a break is split by a re-make longer than any debounce
+  double spikesPerDigit = 0.0;     // Mean noise spikes on the pulse line while the dial returns
+  double spikeUs = 300.0;          // Width of each spike
+};
+
+// Small deterministic PRNG (splitmix64) - identical output on every platform
+class SimRandom {
+public:
+  explicit SimRandom(uint64_t seed) : state_(seed) {}
+
+  uint64_t next() {
+    uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }   // [0, 1)
+  double uniform(double lo, double hi) { return lo + (hi - lo) * uniform(); }
+  int below(int n) { return (int)(uniform() * n); }
+
+private:
+  uint64_t state_;
+};
+
+class DialSimulator {
+public:
+  DialSimulator(const SimParams& params, uint64_t seed) : params_(params), random_(seed) {}
+
+  // Append the edges for one dialed digit (1-9, 0 = ten pulses) starting
+  // at startUs. Edges are appended in time order; returns the time of the
+  // last edge.
+  uint64_t generateDigit(int digit, uint64_t startUs, std::vector<SimEdge>& edges);
+
+  SimRandom& random() { return random_; }
+  const SimParams& params() const { return params_; }
+
+private:
+  uint64_t transition(uint64_t timeUs, uint8_t pin, uint8_t level, std::vector<SimEdge>& edges);
+
+  SimParams params_;
+  SimRandom random_;
+  bool shuntOpen_ = false;
+};
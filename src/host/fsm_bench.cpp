@@ -0,0 +1,85 @@
+/*
+ * Decoder engine benchmark
+ *
+ * Pre-renders simulated dialing into one edge stream, then times feeding
+ * it through the legacy flag-based decoder and the table-driven
+ * DialDecoder. Both must decode the same digits.
+ *
+ *   program fsm-bench [digits] [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "dial_config.h"
+#include "dial_decoder.h"
+#include "dial_sim.h"
+#include "legacy_decoder.h"
+#include "host_tools.h"
+
+// Edge stream with a poll marker after each digit (pin 0xFF)
+#define BENCH_POLL 0xFF
+
+template <typename Decoder>
+static double runDecoder(const std::vector<SimEdge>& edges, int rounds, long& digits, long& checksum) {
+  double best = 1e30;
+  
+  for (int round = 0; round < rounds; round++) {
+    Decoder decoder;
+    digits = 0;
+    checksum = 0;
+    
+    auto start = std::chrono::steady_clock::now();
+    for (const SimEdge& edge : edges) {
+      DialEvent event;
+      if (edge.pin == EDGE_PULSE) {
+        event = decoder.pulseEdge(edge.timeUs, edge.level);
+      } else if (edge.pin == EDGE_SHUNT) {
+        event = decoder.shuntEdge(edge.timeUs, edge.level);
+      } else {
+        event = decoder.poll(edge.timeUs);
+      }
+      if ((event.type == DIAL_EVENT_RESTED || event.type == DIAL_EVENT_TIMEOUT) && event.pulses > 0) {
+        digits++;
+        checksum = checksum * 31 + event.pulses;
+      }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    best = std::min(best, seconds);
+  }
+  return best;
+}
+
+int runFsmBench(int argc, char** argv) {
+  long digitCount = argc > 0 ? atol(argv[0]) : 200000;
+  int rounds = argc > 1 ? atoi(argv[1]) : 5;
+  
+  SimParams params;
+  DialSimulator simulator(params, 1);
+  std::vector<SimEdge> edges;
+  std::vector<SimEdge> digit;
+  uint64_t now = 1000000;
+  
+  for (long n = 0; n < digitCount; n++) {
+    digit.clear();
+    uint64_t end = simulator.generateDigit(simulator.random().below(10), now, digit);
+    edges.insert(edges.end(), digit.begin(), digit.end());
+    now = end + DIAL_SAFETY_TIMEOUT_US + 1;
+    edges.push_back({ now, BENCH_POLL, 0 });
+  }
+  
+  long legacyDigits = 0, legacySum = 0, tableDigits = 0, tableSum = 0;
+  double legacy = runDecoder<LegacyDialDecoder>(edges, rounds, legacyDigits, legacySum);
+  double table = runDecoder<DialDecoder>(edges, rounds, tableDigits, tableSum);
+  
+  printf("%zu events, %ld digits, best of %d rounds\n\n", edges.size(), digitCount, rounds);
+  printf("engine   Mevents/s   ns/event   digits\n");
+  printf("legacy   %9.1f   %8.2f   %6ld\n", edges.size() / legacy / 1e6, legacy * 1e9 / edges.size(), legacyDigits);
+  printf("table    %9.1f   %8.2f   %6ld\n", edges.size() / table / 1e6, table * 1e9 / edges.size(), tableDigits);
+  
+  bool same = legacyDigits == tableDigits && legacySum == tableSum;
+  printf("\n%s\n", same ? "outputs match" : "OUTPUTS DIFFER");
+  return same ? 0 : 1;
+}
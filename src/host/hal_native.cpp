@@ -0,0 +1,149 @@
+/*
+ * HAL - native (host) implementation
+ *
+ * Pins are plain variables, time is a virtual clock advanced by the host
+ * tool, and "interrupts" are called synchronously whenever a scripted pin
+ * changes level - exactly what a CHANGE interrupt would see. Host tools
+ * call dialInputProcess() themselves after every step, so consumer
+ * wake-ups and the timeout timer need no work here. The settle timer does
+ * fire, at its exact time, whenever the clock is moved past it, and so
+ * does the timer of an emulated peripheral (hostArmPeripheralTimer).
+ */
+
+#include "hal.h"
+#include <stdlib.h>
+
+#define HOST_PIN_COUNT 64
+
+static uint64_t hostNow = 0;
+static int pinLevels[HOST_PIN_COUNT];
+static HalIsr pinIsrs[HOST_PIN_COUNT];
+static HalIsr pinPeripherals[HOST_PIN_COUNT];
+static uint32_t isrCount = 0;
+static HalIsr settleCallback = nullptr;
+static uint64_t settleDeadline = 0;   // 0 when not armed
+static HalIsr peripheralCallback = nullptr;
+static uint64_t peripheralDeadline = 0;
+
+uint64_t halMicros() {
+  return hostNow;
+}
+
+int halDigitalRead(uint8_t pin) {
+  return pin < HOST_PIN_COUNT ? pinLevels[pin] : LOW;
+}
+
+uint32_t halReadInputs() {
+  uint32_t inputs = 0;
+  for (int pin = 0; pin < 32; pin++) {
+    if (pinLevels[pin]) {
+      inputs |= 1UL << pin;
+    }
+  }
+  return inputs;
+}
+
+void halPinInputPullup(uint8_t pin) {
+  if (pin < HOST_PIN_COUNT) {
+    pinLevels[pin] = HIGH;
+  }
+}
+
+void halAttachPinsInterrupt(uint32_t pinMask, HalIsr isr) {
+  // hostSetPin() changes one pin at a time, so one entry per pin is exact
+  for (int pin = 0; pin < 32 && pin < HOST_PIN_COUNT; pin++) {
+    if (pinMask & (1UL << pin)) {
+      pinIsrs[pin] = isr;
+    }
+  }
+}
+
+void halBindConsumer() {
+}
+
+void halNotifyFromIsr() {
+}
+
+void halNotifyConsumer() {
+}
+
+void halWaitForWork() {
+}
+
+void halArmTimeout(uint64_t) {
+}
+
+void halCancelTimeout() {
+}
+
+void halBindSettleCallback(HalIsr callback) {
+  settleCallback = callback;
+}
+
+void halArmSettle(uint64_t delayUs) {
+  settleDeadline = hostNow + delayUs;
+}
+
+void halEnterCritical() {
+}
+
+void halExitCritical() {
+}
+
+void* halAllocExternal(size_t bytes) {
+  return malloc(bytes);   // The host has room to spare
+}
+
+uint32_t halLoadSetting(const char*, const char*, uint32_t fallback) {
+  return fallback;
+}
+
+void hostSetMicros(uint64_t now) {
+  // Run the timers on the way, earliest first (callbacks may re-arm them)
+  for (;;) {
+    bool settleDue = settleDeadline && settleDeadline <= now && settleCallback;
+    bool peripheralDue = peripheralDeadline && peripheralDeadline <= now && peripheralCallback;
+    if (peripheralDue && (!settleDue || peripheralDeadline < settleDeadline)) {
+      hostNow = peripheralDeadline;
+      peripheralDeadline = 0;
+      isrCount++;   // The peripheral's completion interrupt
+      peripheralCallback();
+    } else if (settleDue) {
+      hostNow = settleDeadline;
+      settleDeadline = 0;
+      settleCallback();
+    } else {
+      break;
+    }
+  }
+  hostNow = now;
+}
+
+void hostSetPin(uint8_t pin, int level) {
+  if (pin >= HOST_PIN_COUNT || pinLevels[pin] == level) {
+    return;
+  }
+  pinLevels[pin] = level;
+  if (pinPeripherals[pin]) {
+    pinPeripherals[pin]();
+  }
+  if (pinIsrs[pin]) {
+    isrCount++;
+    pinIsrs[pin]();
+  }
+}
+
+void hostAttachPeripheral(uint8_t pin, HalIsr watcher) {
+  if (pin < HOST_PIN_COUNT) {
+    pinPeripherals[pin] = watcher;
+  }
+}
+
+uint32_t hostIsrCount() {
+  return isrCount;
+}
+
+void hostArmPeripheralTimer(uint64_t at, HalIsr callback) {
+  peripheralDeadline = at;
+  peripheralCallback = callback;
+}
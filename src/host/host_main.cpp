@@ -0,0 +1,55 @@
+/*
+ * Native host entry point
+ *
+ * Runs the dial decoder on a developer machine:
+ *   pio run -e native
+ *   .pio/build/native/program <tool> [args...]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "host_tools.h"
+
+struct HostTool {
+  const char* name;
+  int (*run)(int argc, char** argv);
+  const char* usage;
+};
+
+static const HostTool tools[] = {
+  { "script", runScript,     "script <file|->        replay scripted edges through the decoder" },
+  { "stress", runRingStress, "stress [events] [lossy] push events through the edge ring from two threads" },
+  { "simulate", runSimulate, "simulate [key=value...] dial random digits on a virtual clock and score them" },
+  { "bank-bench", runBankBench, "bank-bench [seconds] [seed] time bit-sliced vs per-pin decoding of 1/8/32 lines" },
+  { "fsm-bench", runFsmBench, "fsm-bench [digits] [rounds] time the table-driven decoder against the legacy one" },
+  { "multi-load", runMultiLoad, "multi-load [lines] [seconds] [tick_us] [seed] simulated switchboard load test" },
+  { "telemetry", runTelemetry, "telemetry <file|->     decode binary telemetry frames" },
+  { "trace", runTrace,       "trace <file|->         print an edge trace dump as a script" },
+  { "replay", runReplay,     "replay <file> [digits] decode a trace dump or script and score it against the dialed digits" },
+  { "golden", runGolden,     "golden [manifest] [max_ns=N] check the golden trace corpus for accuracy and speed regressions" },
+  { "tune", runTune,         "tune [manifest] [axis=lo:hi:step...] sweep decoder timing over a trace corpus, print the Pareto front" },
+};
+
+static void printUsage(const char* program) {
+  fprintf(stderr, "Usage: %s <tool> [args...]\n\nTools:\n", program);
+  for (const HostTool& tool : tools) {
+    fprintf(stderr, "  %s\n", tool.usage);
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printUsage(argv[0]);
+    return 2;
+  }
+  
+  for (const HostTool& tool : tools) {
+    if (strcmp(argv[1], tool.name) == 0) {
+      return tool.run(argc - 2, argv + 2);
+    }
+  }
+  
+  fprintf(stderr, "Unknown tool: %s\n\n", argv[1]);
+  printUsage(argv[0]);
+  return 2;
+}
@@ -0,0 +1,21 @@
+/*
+ * Host Tools
+ *
+ * Entry points for the native build's subcommands (see host_main.cpp).
+ * Each tool takes the arguments following its name and returns a
+ * process exit code.
+ */
+
+#pragma once
+
+int runScript(int argc, char** argv);
+int runRingStress(int argc, char** argv);
+int runSimulate(int argc, char** argv);
+int runBankBench(int argc, char** argv);
+int runFsmBench(int argc, char** argv);
+int runMultiLoad(int argc, char** argv);
+int runTelemetry(int argc, char** argv);
+int runTrace(int argc, char** argv);
+int runReplay(int argc, char** argv);
+int runGolden(int argc, char** argv);
+int runTune(int argc, char** argv);
@@ -0,0 +1,75 @@
+/*
+ * Legacy Dial Decoder - see legacy_decoder.h
+ */
+
+#include "legacy_decoder.h"
+#include "dial_config.h"
+
+static DialEvent makeEvent(DialEventType type, int pulses, uint64_t time) {
+  DialEvent event = { type, (uint8_t)pulses, time, 0, 0, 100 };
+  return event;
+}
+
+DialEvent LegacyDialDecoder::pulseEdge(uint64_t now, bool currentPulseState) {
+  // Debounce
+  if (now - lastPulseDebounce_ < PULSE_DEBOUNCE_US) {
+    return makeEvent(DIAL_EVENT_NONE, 0, now);
+  }
+  
+  if (currentPulseState == lastPulseState_) {
+    return makeEvent(DIAL_EVENT_NONE, 0, now);
+  }
+  
+  lastPulseDebounce_ = now;
+  lastPulseState_ = currentPulseState;
+  
+  // Count on HIGH transitions (like working Arduino sketch)
+  if (dialing_ && currentPulseState) {
+    pulseCount_++;
+    lastPulseTime_ = now;
+    dialingTimeout_ = now;  // Reset timeout on each pulse
+    return makeEvent(DIAL_EVENT_PULSE, pulseCount_, now);
+  }
+  
+  return makeEvent(DIAL_EVENT_NONE, 0, now);
+}
+
+DialEvent LegacyDialDecoder::shuntEdge(uint64_t now, bool currentDialState) {
+  // Debounce
+  if (now - lastDialDebounce_ < DIAL_DEBOUNCE_US) {
+    return makeEvent(DIAL_EVENT_NONE, 0, now);
+  }
+  
+  if (currentDialState == lastDialState_) {
+    return makeEvent(DIAL_EVENT_NONE, 0, now);
+  }
+  
+  lastDialDebounce_ = now;
+  lastDialState_ = currentDialState;
+  
+  // Start dialing when shunt goes LOW
+  if (!dialing_ && !currentDialState) {
+    dialing_ = true;
+    pulseCount_ = 0;
+    dialingTimeout_ = now;
+    return makeEvent(DIAL_EVENT_STARTED, 0, now);
+  }
+  
+  // End dialing when shunt goes HIGH (dial returned to rest)
+  if (dialing_ && currentDialState) {
+    dialing_ = false;
+    return makeEvent(DIAL_EVENT_RESTED, pulseCount_, now);
+  }
+  
+  return makeEvent(DIAL_EVENT_NONE, 0, now);
+}
+
+DialEvent LegacyDialDecoder::poll(uint64_t now) {
+  // Keep timeout as safety backup (in case shunt switch fails)
+  if (dialing_ && (now - dialingTimeout_) > DIAL_SAFETY_TIMEOUT_US) {
+    dialing_ = false;
+    return makeEvent(DIAL_EVENT_TIMEOUT, pulseCount_, now);
+  }
+  
+  return makeEvent(DIAL_EVENT_NONE, 0, now);
+}
@@ -0,0 +1,32 @@
+/*
+ * Legacy Dial Decoder
+ *
+ * The flag-based decoder as it was before the table-driven state machine,
+ * kept only as the baseline for the fsm-bench host tool.
+ */
+
+#pragma once
+
+#include "dial_decoder.h"
+
+class LegacyDialDecoder {
+public:
+  DialEvent pulseEdge(uint64_t now, bool currentPulseState);
+  DialEvent shuntEdge(uint64_t now, bool currentDialState);
+  DialEvent poll(uint64_t now);   // Safety timeout check
+
+  bool isDialing() const { return dialing_; }
+  int pulseCount() const { return pulseCount_; }
+
+private:
+  int pulseCount_ = 0;
+  bool dialing_ = false;
+  uint64_t lastPulseTime_ = 0;
+  uint64_t dialingTimeout_ = 0;
+
+  // State tracking
+  bool lastDialState_ = true;
+  bool lastPulseState_ = true;
+  uint64_t lastPulseDebounce_ = 0;
+  uint64_t lastDialDebounce_ = 0;
+};
@@ -0,0 +1,142 @@
+/*
+ * Multi-dial load test
+ *
+ * Simulates a switchboard with every line dialing random digits with
+ * random pauses, merges all edges into one time-ordered stream and feeds
+ * it to a MultiDialDecoder the way the firmware consumer would: one wakeup
+ * per tick, processing everything that arrived since the last one.
+ *
+ * Reports decoder CPU utilisation (host wall time over simulated time),
+ * the worst-case and p99 processing time of a wakeup, and digit accuracy.
+ *
+ *   program multi-load [lines] [seconds] [tick_us] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include "dial_config.h"
+#include "hal.h"
+#include "multi_dial.h"
+#include "dial_sim.h"
+#include "host_tools.h"
+
+struct LineEdge {
+  uint64_t timeUs;
+  uint8_t line;
+  uint8_t pin;
+  uint8_t level;
+};
+
+// Dialed digits per line, consumed as the decoder reports them
+static std::deque<int> expected[MULTI_DIAL_MAX_LINES];
+static long correct = 0;
+static long wrong = 0;
+
+static void checkDigit(const DialEvent& event) {
+  if ((event.type != DIAL_EVENT_RESTED && event.type != DIAL_EVENT_TIMEOUT) || event.pulses == 0) {
+    return;
+  }
+  std::deque<int>& queue = expected[event.line];
+  if (!queue.empty() && queue.front() == pulsesToDigit(event.pulses)) {
+    correct++;
+  } else {
+    wrong++;
+  }
+  if (!queue.empty()) {
+    queue.pop_front();
+  }
+}
+
+int runMultiLoad(int argc, char** argv) {
+  int lines = argc > 0 ? atoi(argv[0]) : MULTI_DIAL_MAX_LINES;
+  double seconds = argc > 1 ? atof(argv[1]) : 600;
+  uint64_t tickUs = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000;
+  uint64_t seed = argc > 3 ? strtoull(argv[3], nullptr, 10) : 1;
+  if (lines < 1 || lines > MULTI_DIAL_MAX_LINES || tickUs == 0) {
+    fprintf(stderr, "multi-load: lines must be 1-%d and tick_us > 0\n", MULTI_DIAL_MAX_LINES);
+    return 2;
+  }
+  
+  MultiDialDecoder decoder(lines);
+  
+  // Render every line's dialing, then merge into one stream
+  SimParams params;
+  std::vector<LineEdge> stream;
+  std::vector<SimEdge> digitEdges;
+  uint64_t endUs = (uint64_t)(seconds * 1e6);
+  long dialed = 0;
+  
+  for (int line = 0; line < lines; line++) {
+    DialSimulator simulator(params, seed * 1000 + line);
+    expected[line].clear();
+    uint64_t t = (uint64_t)simulator.random().uniform(0.1e6, 2e6);   // Not inside the boot-time debounce window
+    while (true) {
+      int digit = simulator.random().below(10);
+      digitEdges.clear();
+      uint64_t end = simulator.generateDigit(digit, t, digitEdges);
+      if (end + decoder.safetyTimeout() >= endUs) {
+        break;
+      }
+      expected[line].push_back(digit);
+      dialed++;
+      for (const SimEdge& edge : digitEdges) {
+        stream.push_back({ edge.timeUs, (uint8_t)line, edge.pin, edge.level });
+      }
+      t = end + (uint64_t)simulator.random().uniform(0.3e6, 1.5e6);
+    }
+  }
+  std::stable_sort(stream.begin(), stream.end(),
+                   [](const LineEdge& a, const LineEdge& b) { return a.timeUs < b.timeUs; });
+  
+  // One consumer wakeup per tick with pending edges (or a due timeout)
+  for (int line = 0; line < lines; line++) {
+    decoder.setInitialLevels(line, LOW, HIGH);   // Lines start at rest
+  }
+  std::vector<double> wakeNs;
+  double busyNs = 0;
+  correct = 0;
+  wrong = 0;
+  
+  size_t next = 0;
+  for (uint64_t tick = tickUs; tick <= endUs; tick += tickUs) {
+    bool due = decoder.deadline() != 0 && decoder.deadline() <= tick;
+    if ((next >= stream.size() || stream[next].timeUs > tick) && !due) {
+      continue;   // Nothing to do - the consumer stays asleep
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    while (next < stream.size() && stream[next].timeUs <= tick) {
+      const LineEdge& edge = stream[next++];
+      DialEvent event = (edge.pin == EDGE_PULSE)
+        ? decoder.pulseEdge(edge.line, edge.timeUs, edge.level)
+        : decoder.shuntEdge(edge.line, edge.timeUs, edge.level);
+      if (event.type != DIAL_EVENT_NONE) {
+        checkDigit(event);
+      }
+    }
+    decoder.poll(tick, checkDigit);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    
+    busyNs += ns;
+    wakeNs.push_back(ns);
+  }
+  
+  std::sort(wakeNs.begin(), wakeNs.end());
+  double p99 = wakeNs.empty() ? 0 : wakeNs[(size_t)(wakeNs.size() * 0.99)];
+  double worst = wakeNs.empty() ? 0 : wakeNs.back();
+  
+  printf("lines:            %d\n", lines);
+  printf("simulated:        %.0f s, tick %llu us\n", seconds, (unsigned long long)tickUs);
+  printf("edges:            %zu (%.0f/s)\n", stream.size(), stream.size() / seconds);
+  printf("digits:           %ld dialed, %ld correct, %ld wrong\n", dialed, correct, wrong);
+  printf("wakeups:          %zu\n", wakeNs.size());
+  printf("CPU utilisation:  %.4f%% (host)\n", busyNs / (seconds * 1e9) * 100.0);
+  printf("wakeup p99:       %.0f ns\n", p99);
+  printf("wakeup worst:     %.0f ns\n", worst);
+  printf("worst latency:    %.1f us (tick + worst wakeup)\n", tickUs + worst / 1000.0);
+  return correct == dialed && wrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+/*
+ * Pulse Capture - native emulation of the RMT receiver
+ *
+ * Builds the symbol stream the RMT would record from the scripted pulse
+ * pin: level durations in PULSE_CAPTURE_TICK_US ticks, a zero-duration end
+ * marker once the line has been idle for idleUs, and frames cut short at
+ * the receiver's memory size. The idle check runs on a peripheral timer,
+ * so frames complete at the exact virtual time the hardware would finish
+ * them; each frame counts as one interrupt in hostIsrCount(), like the
+ * RMT receive-done interrupt.
+ */
+
+#include "pulse_capture.h"
+#include "hal.h"
+
+static uint8_t capturePin = 0;
+static uint32_t captureIdleUs = 0;
+static PulseFrameHandler frameHandler = nullptr;
+
+static PulseSymbol frame[PULSE_CAPTURE_MAX_SYMBOLS];
+static size_t halves = 0;
+static bool receiving = false;
+static int segmentLevel = LOW;
+static uint64_t segmentStart = 0;
+
+static void addHalf(int level, uint32_t ticks) {
+  if (halves >= 2 * PULSE_CAPTURE_MAX_SYMBOLS) {
+    return;   // Memory full - the rest of the frame is lost, as on the RMT
+  }
+  PulseSymbol& symbol = frame[halves / 2];
+  if (halves & 1) {
+    symbol.level1 = level;
+    symbol.duration1 = ticks;
+  } else {
+    symbol.level0 = level;
+    symbol.duration0 = ticks;
+    symbol.level1 = 0;
+    symbol.duration1 = 0;
+  }
+  halves++;
+}
+
+static void onIdle() {
+  if (!receiving) {
+    return;
+  }
+  if (halves >= 2 * PULSE_CAPTURE_MAX_SYMBOLS) {
+    halves--;   // Keep room for the end marker
+  }
+  addHalf(segmentLevel, 0);
+  receiving = false;
+  frameHandler(frame, (halves + 1) / 2, segmentStart + captureIdleUs);
+  halves = 0;
+}
+
+static void onCapturePin() {
+  uint64_t now = halMicros();
+  int level = halDigitalRead(capturePin);
+  if (receiving) {
+    uint64_t ticks = (now - segmentStart) / PULSE_CAPTURE_TICK_US;
+    if (ticks == 0) {
+      // Shorter than the input filter: the level never left, so the
+      // segment before it simply continues
+      if (halves == 0) {
+        receiving = false;
+        return;
+      }
+      halves--;
+      PulseSymbol& symbol = frame[halves / 2];
+      segmentLevel = (halves & 1) ? symbol.level1 : symbol.level0;
+      segmentStart -= (uint64_t)((halves & 1) ? symbol.duration1 : symbol.duration0) * PULSE_CAPTURE_TICK_US;
+      hostArmPeripheralTimer(segmentStart + captureIdleUs > now ? segmentStart + captureIdleUs : now, onIdle);
+      return;
+    }
+    addHalf(segmentLevel, ticks > 0x7FFF ? 0x7FFF : (uint32_t)ticks);
+  }
+  receiving = true;
+  segmentLevel = level;
+  segmentStart = now;
+  hostArmPeripheralTimer(now + captureIdleUs, onIdle);
+}
+
+bool pulseCaptureBegin(uint8_t pin, uint32_t idleUs, PulseFrameHandler handler) {
+  capturePin = pin;
+  captureIdleUs = idleUs;
+  frameHandler = handler;
+  receiving = false;
+  halves = 0;
+  hostAttachPeripheral(pin, onCapturePin);
+  return idleUs < PULSE_CAPTURE_MAX_DURATION_US;
+}
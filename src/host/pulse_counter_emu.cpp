@@ -0,0 +1,60 @@
+/*
+ * Pulse Counter - native emulation of the PCNT unit
+ *
+ * Watches the scripted pulse pin the way the peripheral watches the GPIO
+ * matrix: a new level only counts once it has been stable for the filter
+ * time, and only rising edges of that filtered signal are counted. The
+ * watcher is not an interrupt, so it does not show up in hostIsrCount().
+ * Unlike the hardware, the filter is not limited to ~12.8 us.
+ */
+
+#include "pulse_counter.h"
+#include "hal.h"
+
+static uint8_t counterPin = 0;
+static uint64_t filterUs = 0;
+static int count = 0;
+static int stableLevel = LOW;
+static int pendingLevel = LOW;
+static uint64_t pendingSince = 0;
+static bool pending = false;
+
+// Accept the pending level if it has outlasted the filter
+static void settle(uint64_t now) {
+  if (!pending || now - pendingSince < filterUs) {
+    return;
+  }
+  if (pendingLevel != stableLevel && pendingLevel == HIGH) {
+    count++;
+  }
+  stableLevel = pendingLevel;
+  pending = false;
+}
+
+static void onCounterPin() {
+  uint64_t now = halMicros();
+  settle(now);
+  pendingLevel = halDigitalRead(counterPin);
+  pendingSince = now;
+  pending = true;
+}
+
+bool pulseCounterBegin(uint8_t pin, uint32_t filterNs) {
+  counterPin = pin;
+  filterUs = (filterNs + 999) / 1000;
+  count = 0;
+  stableLevel = halDigitalRead(pin);
+  pending = false;
+  hostAttachPeripheral(pin, onCounterPin);
+  return true;
+}
+
+int pulseCounterRead() {
+  settle(halMicros());
+  return (int16_t)count;
+}
+
+void pulseCounterClear() {
+  settle(halMicros());
+  count = 0;
+}
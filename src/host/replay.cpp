@@ -0,0 +1,374 @@
+/*
+ * Replay Engine - see replay.h
+ */
+
+#include "replay.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include "dial_config.h"
+#include "dial_input.h"
+#include "edge_trace.h"
+#include "hal.h"
+
+static bool readFile(const char* path, std::vector<uint8_t>& data) {
+  FILE* in = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+  if (!in) {
+    return false;
+  }
+  uint8_t chunk[4096];
+  size_t length;
+  while ((length = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    data.insert(data.end(), chunk, chunk + length);
+  }
+  if (in != stdin) fclose(in);
+  return true;
+}
+
+// The first trace dump in data that decodes and whose CRC checks out
+static bool loadTrace(const std::vector<uint8_t>& data, std::vector<EdgeEvent>& edges) {
+  for (size_t start = 0; start + EDGE_TRACE_HEADER_SIZE + 2 <= data.size(); start++) {
+    if (memcmp(&data[start], EDGE_TRACE_MAGIC, 4) != 0) {
+      continue;
+    }
+    EdgeTraceReader reader;
+    EdgeEvent edge;
+    edges.clear();
+    for (size_t i = start; i < data.size() && !reader.finished() && !reader.failed(); i++) {
+      if (reader.feed(data[i], edge)) {
+        edges.push_back(edge);
+      }
+    }
+    if (reader.ok() && edges.size() == reader.edgeCount()) {
+      return true;
+    }
+  }
+  edges.clear();
+  return false;
+}
+
+// "time_ms pin level" lines, as the script tool reads them
+static bool loadScript(const std::vector<uint8_t>& data, std::vector<EdgeEvent>& edges) {
+  std::string text(data.begin(), data.end());
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t end = text.find('\n', pos);
+    std::string line = text.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+    pos = end == std::string::npos ? text.size() : end + 1;
+    size_t hash = line.find('#');
+    if (hash != std::string::npos) {
+      line.resize(hash);
+    }
+    
+    double timeMs;
+    char pin[16];
+    int level;
+    int fields = sscanf(line.c_str(), "%lf %15s %d", &timeMs, pin, &level);
+    if (fields <= 0) {
+      continue;
+    }
+    if (fields != 3 || timeMs < 0 || (strcmp(pin, "pulse") != 0 && strcmp(pin, "shunt") != 0)) {
+      return false;
+    }
+    EdgeEvent edge;
+    edge.time = (uint64_t)(timeMs * 1000.0 + 0.5);
+    edge.pin = strcmp(pin, "pulse") == 0 ? EDGE_PULSE : EDGE_SHUNT;
+    edge.level = level ? 1 : 0;
+    edges.push_back(edge);
+  }
+  return !edges.empty();
+}
+
+bool replayLoadEdges(const char* path, std::vector<EdgeEvent>& edges) {
+  std::vector<uint8_t> data;
+  edges.clear();
+  if (!readFile(path, data) || !(loadTrace(data, edges) || loadScript(data, edges))) {
+    return false;
+  }
+  std::stable_sort(edges.begin(), edges.end(),
+                   [](const EdgeEvent& a, const EdgeEvent& b) { return a.time < b.time; });
+  return true;
+}
+
+bool replayLoadDigits(const char* path, std::vector<int>& digits) {
+  std::vector<uint8_t> data;
+  if (!readFile(path, data)) {
+    return false;
+  }
+  digits.clear();
+  bool comment = false;
+  for (uint8_t c : data) {
+    if (c == '\n') {
+      comment = false;
+    } else if (c == '#') {
+      comment = true;
+    } else if (!comment && c >= '0' && c <= '9') {
+      digits.push_back(c - '0');
+    }
+  }
+  return true;
+}
+
+bool replayLoadCorpus(const char* manifest, ReplayCorpus& corpus) {
+  FILE* in = fopen(manifest, "r");
+  if (!in) {
+    fprintf(stderr, "cannot open %s\n", manifest);
+    return false;
+  }
+  std::string directory(manifest);
+  size_t slash = directory.find_last_of('/');
+  directory = slash == std::string::npos ? "" : directory.substr(0, slash + 1);
+  
+  char line[256];
+  int lineNumber = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), in)) {
+    lineNumber++;
+    char* hash = strchr(line, '#');
+    if (hash) {
+      *hash = '\0';
+    }
+    if (sscanf(line, "max_ns_per_edge %lf", &corpus.maxNsPerEdge) == 1) {
+      continue;
+    }
+    char name[128];
+    char path[16];
+    ReplayTrace trace;
+    int fields = sscanf(line, "%127s %lf %ld %15s", name, &trace.minAccuracy, &trace.maxFalse, path);
+    if (fields <= 0) {
+      continue;
+    }
+    if (fields < 3 || (fields == 4 && !replayParseInputPath(path, trace.input))) {
+      fprintf(stderr, "%s: bad line %d\n", manifest, lineNumber);
+      ok = false;
+      break;
+    }
+    trace.name = name;
+    std::string base = directory + name;
+    if (!replayLoadEdges((base + ".trace").c_str(), trace.edges)
+        || !replayLoadDigits((base + ".digits").c_str(), trace.dialed)) {
+      fprintf(stderr, "%s: cannot load %s.trace / .digits\n", manifest, base.c_str());
+      ok = false;
+      break;
+    }
+    corpus.traces.push_back(std::move(trace));
+  }
+  fclose(in);
+  if (ok && corpus.traces.empty()) {
+    fprintf(stderr, "%s: no traces\n", manifest);
+    ok = false;
+  }
+  return ok;
+}
+
+// Manifest names of the input paths, by DIAL_COUNTER_* backend
+static const char* const inputPathNames[] = { "isr", "pcnt", "rmt" };
+
+bool replayParseInputPath(const char* name, ReplayInputPath& input) {
+  input = ReplayInputPath();
+  if (strcmp(name, "settle") == 0) {
+    input.settle = true;
+    return true;
+  }
+  for (uint8_t counter = 0; counter < sizeof(inputPathNames) / sizeof(inputPathNames[0]); counter++) {
+    if (strcmp(name, inputPathNames[counter]) == 0) {
+      input.counter = counter;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* replayInputPathName(const ReplayInputPath& input) {
+  return input.settle ? "settle" : inputPathNames[input.counter];
+}
+
+// Append a completed digit, timed from the last raw pulse edge
+static void collectDigit(const DialEvent& event, uint64_t lastPulse, std::vector<ReplayDigit>& digits) {
+  if ((event.type == DIAL_EVENT_RESTED || event.type == DIAL_EVENT_TIMEOUT) && event.pulses > 0) {
+    uint64_t latency = event.time > lastPulse ? event.time - lastPulse : 0;
+    digits.push_back({ pulsesToDigit(event.pulses), event.flags, (uint32_t)latency });
+  }
+}
+
+void replayDecode(DialDecoder& decoder, const std::vector<EdgeEvent>& edges, std::vector<ReplayDigit>& digits) {
+  uint64_t lastPulse = 0;
+  auto collect = [&](const DialEvent& event) {
+    collectDigit(event, lastPulse, digits);
+  };
+  
+  // Run every deadline up to t, as the one-shot timer would
+  auto pollUntil = [&](uint64_t t) {
+    uint64_t due = decoder.deadline();
+    while (due && due <= t) {
+      collect(decoder.poll(due));
+      uint64_t next = decoder.deadline();
+      if (next == due) {
+        break;
+      }
+      due = next;
+    }
+  };
+  
+  decoder.setInitialLevels(false, true);   // At rest: pulse contact closed, shunt HIGH
+  for (const EdgeEvent& edge : edges) {
+    pollUntil(edge.time);
+    if (edge.pin == EDGE_PULSE) {
+      collect(decoder.pulseEdge(edge.time, edge.level));
+      lastPulse = edge.time;
+    } else {
+      collect(decoder.shuntEdge(edge.time, edge.level));
+    }
+  }
+  
+  uint64_t end = (edges.empty() ? 0 : edges.back().time) + decoder.safetyTimeout() + 1;
+  pollUntil(end);
+  collect(decoder.poll(end));
+}
+
+// Where dialInputProcess() reports to during replayInput(). Digits are
+// timed from the last pulse edge at or before the event, looked up among
+// the pulse edges played: in RMT mode a digit can come out only after the
+// next one's first pulses were played.
+static std::vector<ReplayDigit>* inputDigits = nullptr;
+static std::vector<uint64_t> inputPulseTimes;
+
+static void onInputEvent(const DialEvent& event) {
+  auto after = std::upper_bound(inputPulseTimes.begin(), inputPulseTimes.end(), event.time);
+  collectDigit(event, after == inputPulseTimes.begin() ? 0 : *(after - 1), *inputDigits);
+}
+
+// Advance the virtual clock to t, stopping at every input deadline on the
+// way, as the one-shot timer would (see simulate.cpp)
+static void advanceInputTo(uint64_t t) {
+  uint64_t deadline = dialInputDeadline();
+  while (deadline && deadline <= t) {
+    hostSetMicros(deadline);
+    dialInputProcess(onInputEvent);
+    uint64_t next = dialInputDeadline();
+    if (next == deadline) {
+      break;
+    }
+    deadline = next;
+  }
+  hostSetMicros(t);
+}
+
+void replayInput(const std::vector<EdgeEvent>& edges, const ReplayInputPath& input, const DialTiming& timing,
+                 std::vector<ReplayDigit>& digits) {
+  inputDigits = &digits;
+  inputPulseTimes.clear();
+  
+  // Fresh decoder and input state; the last run's emulated counter lets go
+  // of the pulse pin, and dialInputBegin() pulls both pins up
+  hostAttachPeripheral(ROTARY_PULSE_PIN, nullptr);
+  dialDecoder = DialDecoder();
+  dialDecoder.setTiming(timing);
+  dialInputSetSettleSampling(input.settle);
+  dialInputSetCounter(input.counter);
+  uint64_t start = halMicros();
+  dialInputBegin();
+  
+  // At rest the pulse contact is closed; the first edge plays one second
+  // after the restart, outside any boot-time debounce window
+  advanceInputTo(start + 500000);
+  hostSetPin(ROTARY_PULSE_PIN, LOW);
+  dialInputProcess(onInputEvent);
+  int64_t offset = edges.empty() ? 0 : (int64_t)(start + 1000000) - (int64_t)edges.front().time;
+  
+  for (const EdgeEvent& edge : edges) {
+    uint64_t time = (uint64_t)((int64_t)edge.time + offset);
+    advanceInputTo(time);
+    if (edge.pin == EDGE_PULSE) {
+      inputPulseTimes.push_back(time);
+    }
+    hostSetPin(edge.pin == EDGE_PULSE ? ROTARY_PULSE_PIN : ROTARY_SHUNT_PIN, edge.level);
+    dialInputProcess(onInputEvent);
+  }
+  
+  // Run the safety timeout out, plus the capture lag in RMT mode
+  uint64_t end = halMicros() + dialDecoder.safetyTimeout() + PULSE_CAPTURE_IDLE_US + PULSE_CAPTURE_MARGIN_US + 1;
+  advanceInputTo(end);
+  dialInputProcess(onInputEvent);
+  inputDigits = nullptr;
+}
+
+// Alignment costs are kept for the diagonals low..high (j - i) only: row i
+// of the band holds columns i + low .. i + high, and cells outside it are
+// unreachable
+#define REPLAY_FAR (UINT32_MAX / 2)
+
+static uint32_t bandCost(const std::vector<uint32_t>& cost, long width, long low, long i, long j) {
+  long d = j - i - low;
+  return d < 0 || d >= width ? REPLAY_FAR : cost[i * width + d];
+}
+
+void replayScore(const std::vector<int>& dialed, const std::vector<ReplayDigit>& decoded, ReplayScore& score) {
+  long n = (long)dialed.size();
+  long m = (long)decoded.size();
+  
+  // An alignment of cost k never leaves the diagonals between the two
+  // corners by more than k, so a band that wide gives the exact cost once
+  // that cost is at most k. Widen it until then: memory grows with the
+  // number of errors instead of n * m.
+  std::vector<uint32_t> cost;
+  long low, width;
+  for (long k = 8; ; k *= 2) {
+    low = std::min(0L, m - n) - k;
+    width = std::max(0L, m - n) + k - low + 1;
+    cost.assign((size_t)((n + 1) * width), REPLAY_FAR);
+    for (long i = 0; i <= n; i++) {
+      for (long j = std::max(0L, i + low); j <= std::min(m, i + low + width - 1); j++) {
+        uint32_t best;
+        if (i == 0 || j == 0) {
+          best = (uint32_t)(i + j);
+        } else {
+          uint32_t substitute = bandCost(cost, width, low, i - 1, j - 1) + (dialed[i - 1] != decoded[j - 1].digit);
+          uint32_t skip = std::min(bandCost(cost, width, low, i - 1, j), bandCost(cost, width, low, i, j - 1)) + 1;
+          best = std::min(substitute, skip);
+        }
+        cost[i * width + (j - i - low)] = best;
+      }
+    }
+    if (bandCost(cost, width, low, n, m) <= (uint32_t)k || width > n + m) {
+      break;
+    }
+  }
+  
+  // Walk the cheapest alignment back from the end
+  score = ReplayScore();
+  score.expected = n;
+  long i = n, j = m;
+  while (i > 0 || j > 0) {
+    uint32_t here = bandCost(cost, width, low, i, j);
+    if (i > 0 && j > 0
+        && here == bandCost(cost, width, low, i - 1, j - 1) + (dialed[i - 1] != decoded[j - 1].digit)) {
+      (dialed[i - 1] == decoded[j - 1].digit ? score.correct : score.wrong)++;
+      i--;
+      j--;
+    } else if (i > 0 && here == bandCost(cost, width, low, i - 1, j) + 1) {
+      score.missed++;
+      i--;
+    } else {
+      score.falseDigits++;
+      j--;
+    }
+  }
+}
+
+double replayNsPerEdge(const std::vector<EdgeEvent>& edges, int rounds) {
+  double best = 1e30;
+  std::vector<ReplayDigit> digits;
+  digits.reserve(edges.size() / 8 + 16);
+  for (int round = 0; round < rounds; round++) {
+    DialDecoder decoder;
+    digits.clear();
+    auto start = std::chrono::steady_clock::now();
+    replayDecode(decoder, edges, digits);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    best = std::min(best, seconds);
+  }
+  return edges.empty() ? 0 : best * 1e9 / edges.size();
+}
@@ -0,0 +1,103 @@
+/*
+ * Replay Engine
+ *
+ * Streams a recorded or synthetic edge trace through the decoder and
+ * scores the digits against the ones actually dialed. Used by the replay,
+ * golden and tune tools.
+ *
+ * replayDecode() calls a DialDecoder directly - no ISRs, ring or virtual
+ * clock, just the decoder calls and its deadlines in time order - which is
+ * what the time budget and the tuner measure. replayInput() instead drives
+ * the trace's pin levels through dial_input.cpp on the native HAL, as
+ * simulate does: the ISR and edge ring, settle sampling, or the emulated
+ * PCNT and RMT counters, so the corpus covers the firmware's whole input
+ * path.
+ *
+ * Edges load from a trace dump (edge_trace.h, console text around it is
+ * skipped) or a script (see script_runner.cpp). Dialed digits load from a
+ * text file of digits 0-9; anything else is ignored, and lines starting
+ * with '#' are comments.
+ *
+ * A corpus manifest lists traces with their pass criteria, one per line,
+ * plus a decoder time budget:
+ *
+ *   max_ns_per_edge <ns>
+ *   <name> <min accuracy %> <max false digits> [input path]
+ *
+ * and names the files <name>.trace and <name>.digits next to it. The input
+ * path is isr (the default), settle, pcnt or rmt; a trace can be listed
+ * once per path.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "dial_decoder.h"
+#include "edge_ring.h"
+
+struct ReplayDigit {
+  int digit;
+  uint8_t flags;         // DIAL_FLAG_*
+  uint32_t latencyUs;    // Last raw pulse edge to the digit being reported
+};
+
+struct ReplayScore {
+  long expected = 0;     // Digits dialed
+  long correct = 0;
+  long wrong = 0;        // Decoded as another digit
+  long missed = 0;       // Never decoded
+  long falseDigits = 0;  // Decoded with nothing dialed
+  
+  double accuracy() const { return expected ? 100.0 * correct / expected : 100.0; }
+};
+
+// Firmware input path a trace is replayed through
+struct ReplayInputPath {
+  bool settle = false;                  // Deferred settle sampling
+  uint8_t counter = DIAL_COUNTER_ISR;   // DIAL_COUNTER_* backend
+};
+
+struct ReplayTrace {
+  std::string name;
+  std::vector<EdgeEvent> edges;
+  std::vector<int> dialed;
+  double minAccuracy;
+  long maxFalse;
+  ReplayInputPath input;
+};
+
+struct ReplayCorpus {
+  std::vector<ReplayTrace> traces;
+  double maxNsPerEdge = 0;   // 0: no budget
+};
+
+// Returns false if the file cannot be read or holds no valid trace or script
+bool replayLoadEdges(const char* path, std::vector<EdgeEvent>& edges);
+bool replayLoadDigits(const char* path, std::vector<int>& digits);
+
+// Load a manifest and all its traces; reports problems on stderr
+bool replayLoadCorpus(const char* manifest, ReplayCorpus& corpus);
+
+// Input path by manifest name (isr, settle, pcnt, rmt); false if unknown
+bool replayParseInputPath(const char* name, ReplayInputPath& input);
+const char* replayInputPathName(const ReplayInputPath& input);
+
+// Decode edges (in time order) with decoder, which starts at rest, and
+// run its deadlines out past the last edge. Appends each completed digit.
+void replayDecode(DialDecoder& decoder, const std::vector<EdgeEvent>& edges, std::vector<ReplayDigit>& digits);
+
+// The same through the firmware input path: resets the global dialDecoder
+// to timing, restarts dial_input.cpp with input and plays the edges on the
+// pins from the virtual clock's current time on, so runs go back to back
+void replayInput(const std::vector<EdgeEvent>& edges, const ReplayInputPath& input, const DialTiming& timing,
+                 std::vector<ReplayDigit>& digits);
+
+// Align the decoded digits with the dialed ones (fewest edits) and count
+// matches, substitutions, misses and insertions. Memory grows with the
+// length times the number of edits, not with the two lengths multiplied.
+void replayScore(const std::vector<int>& dialed, const std::vector<ReplayDigit>& decoded, ReplayScore& score);
+
+// Best time per edge over rounds of decoding with a fresh decoder, in ns
+double replayNsPerEdge(const std::vector<EdgeEvent>& edges, int rounds);
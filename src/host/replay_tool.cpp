@@ -0,0 +1,166 @@
+/*
+ * Trace replay and golden corpus check
+ *
+ * replay decodes one trace dump or script through the firmware input path
+ * with the replay engine (replay.h) and, given the digits actually
+ * dialed, scores it:
+ *
+ *   program replay capture.bin dialed.txt [input=isr|settle|pcnt|rmt]
+ *
+ * golden runs every trace of a corpus manifest through its input path and
+ * fails (exit status 1) when a trace decodes below its accuracy floor,
+ * produces more false digits than allowed, or the decoder alone gets
+ * slower than the manifest's budget per edge (manifest format in
+ * replay.h).
+ *
+ *   program golden corpus/golden.txt [max_ns=<ns>] [rounds=<n>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "replay.h"
+#include "host_tools.h"
+
+#define REPLAY_ROUNDS 5
+
+// Latency percentile in ms (latencies sorted)
+static double percentileMs(const std::vector<uint32_t>& sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+  return sorted[index] / 1000.0;
+}
+
+static std::vector<uint32_t> sortedLatencies(const std::vector<ReplayDigit>& digits) {
+  std::vector<uint32_t> latencies;
+  for (const ReplayDigit& digit : digits) {
+    latencies.push_back(digit.latencyUs);
+  }
+  std::sort(latencies.begin(), latencies.end());
+  return latencies;
+}
+
+static bool parseOption(const char* arg, const char* key, double& value) {
+  size_t length = strlen(key);
+  if (strncmp(arg, key, length) != 0 || arg[length] != '=') {
+    return false;
+  }
+  value = atof(arg + length + 1);
+  return true;
+}
+
+int runReplay(int argc, char** argv) {
+  if (argc < 1) {
+    fprintf(stderr, "replay: missing file argument\n");
+    return 2;
+  }
+  std::vector<EdgeEvent> edges;
+  if (!replayLoadEdges(argv[0], edges)) {
+    fprintf(stderr, "replay: no trace dump or script in %s\n", argv[0]);
+    return 1;
+  }
+  const char* dialedPath = nullptr;
+  double rounds = REPLAY_ROUNDS;
+  ReplayInputPath input;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "input=", 6) == 0) {
+      if (!replayParseInputPath(argv[i] + 6, input)) {
+        fprintf(stderr, "replay: unknown input path %s\n", argv[i] + 6);
+        return 2;
+      }
+    } else if (!parseOption(argv[i], "rounds", rounds)) {
+      dialedPath = argv[i];
+    }
+  }
+  
+  std::vector<ReplayDigit> decoded;
+  replayInput(edges, input, DialTiming(), decoded);
+  
+  printf("input:       %s\n", replayInputPathName(input));
+  printf("edges:       %zu\n", edges.size());
+  printf("decoded:     %zu digits\n", decoded.size());
+  if (dialedPath) {
+    std::vector<int> dialed;
+    if (!replayLoadDigits(dialedPath, dialed)) {
+      fprintf(stderr, "replay: cannot open %s\n", dialedPath);
+      return 1;
+    }
+    ReplayScore score;
+    replayScore(dialed, decoded, score);
+    printf("dialed:      %ld\n", score.expected);
+    printf("correct:     %ld (%.3f%%)\n", score.correct, score.accuracy());
+    printf("wrong:       %ld\n", score.wrong);
+    printf("missed:      %ld\n", score.missed);
+    printf("false:       %ld\n", score.falseDigits);
+  } else {
+    printf("digits:      ");
+    for (const ReplayDigit& digit : decoded) {
+      printf("%d", digit.digit);
+    }
+    printf("\n");
+  }
+  
+  std::vector<uint32_t> latencies = sortedLatencies(decoded);
+  printf("latency:     %.1f / %.1f / %.1f / %.1f ms (p50 / p90 / p99 / max) after the last pulse edge\n",
+         percentileMs(latencies, 0.5), percentileMs(latencies, 0.9), percentileMs(latencies, 0.99),
+         percentileMs(latencies, 1.0));
+  double ns = replayNsPerEdge(edges, (int)rounds);
+  printf("decoder:     %.1f ns per edge (%.1f Medges/s, best of %d rounds)\n",
+         ns, ns > 0 ? 1000.0 / ns : 0.0, (int)rounds);
+  return 0;
+}
+
+int runGolden(int argc, char** argv) {
+  const char* manifestPath = "corpus/golden.txt";
+  double maxNs = 0;
+  double rounds = REPLAY_ROUNDS;
+  for (int i = 0; i < argc; i++) {
+    if (!parseOption(argv[i], "max_ns", maxNs) && !parseOption(argv[i], "rounds", rounds)) {
+      manifestPath = argv[i];
+    }
+  }
+  ReplayCorpus corpus;
+  if (!replayLoadCorpus(manifestPath, corpus)) {
+    return 1;
+  }
+  
+  printf("trace                 input   digits  accuracy  wrong  missed  false  p50 ms  p99 ms  ns/edge\n");
+  int passed = 0;
+  double totalNs = 0;
+  size_t totalEdges = 0;
+  for (const ReplayTrace& trace : corpus.traces) {
+    std::vector<ReplayDigit> decoded;
+    replayInput(trace.edges, trace.input, DialTiming(), decoded);
+    ReplayScore score;
+    replayScore(trace.dialed, decoded, score);
+    std::vector<uint32_t> latencies = sortedLatencies(decoded);
+    double ns = replayNsPerEdge(trace.edges, (int)rounds);
+    totalNs += ns * trace.edges.size();
+    totalEdges += trace.edges.size();
+    
+    bool pass = score.accuracy() >= trace.minAccuracy && score.falseDigits <= trace.maxFalse;
+    printf("%-20s  %-6s  %6ld  %7.2f%%  %5ld  %6ld  %5ld  %6.1f  %6.1f  %7.1f  %s\n", trace.name.c_str(),
+           replayInputPathName(trace.input), score.expected, score.accuracy(), score.wrong, score.missed, score.falseDigits,
+           percentileMs(latencies, 0.5), percentileMs(latencies, 0.99), ns, pass ? "ok" : "FAIL");
+    if (pass) {
+      passed++;
+    } else {
+      printf("%-28s  needs %.2f%% and at most %ld false digits\n", "", trace.minAccuracy, trace.maxFalse);
+    }
+  }
+  
+  // The command line budget overrides the manifest's (slower CI machines)
+  double budget = maxNs > 0 ? maxNs : corpus.maxNsPerEdge;
+  double meanNs = totalEdges ? totalNs / totalEdges : 0;
+  bool fastEnough = budget <= 0 || meanNs <= budget;
+  printf("\ndecoder:     %.1f ns per edge over %zu edges (budget %.0f)%s\n",
+         meanNs, totalEdges, budget, fastEnough ? "" : " FAIL");
+  bool ok = fastEnough && passed == (int)corpus.traces.size();
+  printf("result:      %s (%d of %zu traces passed)\n", ok ? "ok" : "FAIL", passed, corpus.traces.size());
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+/*
+ * Scripted edge replay
+ *
+ * Reads edge lines from a file (or stdin with "-") and drives them through
+ * the real ISRs, edge ring and decoder via the native HAL:
+ *
+ *   # time_ms  pin    level
+ *   100        shunt  0
+ *   180        pulse  0
+ *   240        pulse  1
+ *   ...
+ *
+ * Times are milliseconds and may have a fractional part (microsecond
+ * resolution). Pins are "pulse" or "shunt"; levels are 0 or 1. Lines must
+ * be in time order. Decoder events are printed one per line so runs can be diffed.
+ *
+ * "script <file> rmt" replays through the RMT capture backend instead and
+ * also prints each captured frame's level durations.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "hal.h"
+#include "dial_input.h"
+#include "host_tools.h"
+
+static void printEvent(const DialEvent& event) {
+  switch (event.type) {
+    case DIAL_EVENT_STARTED:
+      printf("%12.3f started\n", event.time / 1000.0);
+      break;
+    case DIAL_EVENT_PULSE:
+      printf("%12.3f pulse %d\n", event.time / 1000.0, event.pulses);
+      break;
+    case DIAL_EVENT_RESTED:
+      printf("%12.3f rested %d digit %d\n", event.time / 1000.0, event.pulses, pulsesToDigit(event.pulses));
+      break;
+    case DIAL_EVENT_TIMEOUT:
+      printf("%12.3f timeout %d digit %d\n", event.time / 1000.0, event.pulses, pulsesToDigit(event.pulses));
+      break;
+    default:
+      break;
+  }
+}
+
+// Print the capture frame if a new one arrived since the last call
+static void printNewFrame() {
+  static uint32_t printed = 0;
+  static PulseSymbol symbols[PULSE_CAPTURE_MAX_SYMBOLS];
+  size_t count = 0;
+  uint32_t frames = dialInputLastFrame(symbols, PULSE_CAPTURE_MAX_SYMBOLS, &count);
+  if (frames == printed) {
+    return;
+  }
+  printed = frames;
+  printf("%12s frame", "");
+  for (size_t i = 0; i < 2 * count; i++) {
+    uint32_t ticks = (i & 1) ? symbols[i / 2].duration1 : symbols[i / 2].duration0;
+    int level = (i & 1) ? symbols[i / 2].level1 : symbols[i / 2].level0;
+    if (ticks == 0) {
+      break;
+    }
+    printf(" %c%.3f", level ? 'H' : 'L', ticks * PULSE_CAPTURE_TICK_US / 1000.0);
+  }
+  printf("\n");
+}
+
+int runScript(int argc, char** argv) {
+  if (argc < 1) {
+    fprintf(stderr, "script: missing file argument\n");
+    return 2;
+  }
+  
+  FILE* in = strcmp(argv[0], "-") == 0 ? stdin : fopen(argv[0], "r");
+  if (!in) {
+    fprintf(stderr, "script: cannot open %s\n", argv[0]);
+    return 1;
+  }
+  
+  bool capture = argc > 1 && strcmp(argv[1], "rmt") == 0;
+  if (capture) {
+    dialInputSetCounter(DIAL_COUNTER_RMT);
+  }
+  dialInputBegin();
+  
+  char line[128];
+  int lineNumber = 0;
+  uint64_t now = 0;
+  while (fgets(line, sizeof(line), in)) {
+    lineNumber++;
+    char* hash = strchr(line, '#');
+    if (hash) {
+      *hash = '\0';
+    }
+    
+    double timeMs;
+    char pin[16];
+    int level;
+    int fields = sscanf(line, "%lf %15s %d", &timeMs, pin, &level);
+    if (fields <= 0) {
+      continue;  // Blank or comment
+    }
+    if (fields != 3 || (strcmp(pin, "pulse") != 0 && strcmp(pin, "shunt") != 0)
+        || timeMs < 0 || (uint64_t)(timeMs * 1000.0 + 0.5) < now) {
+      fprintf(stderr, "script: bad line %d\n", lineNumber);
+      if (in != stdin) fclose(in);
+      return 1;
+    }
+    
+    now = (uint64_t)(timeMs * 1000.0 + 0.5);
+    hostSetMicros(now);
+    hostSetPin(strcmp(pin, "pulse") == 0 ? ROTARY_PULSE_PIN : ROTARY_SHUNT_PIN, level ? HIGH : LOW);
+    dialInputProcess(printEvent);
+    if (capture) {
+      printNewFrame();
+    }
+  }
+  if (in != stdin) fclose(in);
+  
+  // Let the safety timeout fire for any dial left off-normal (decoding
+  // runs behind by the capture lag in RMT mode)
+  uint64_t lag = capture ? PULSE_CAPTURE_IDLE_US + PULSE_CAPTURE_MARGIN_US : 0;
+  hostSetMicros(now + dialDecoder.safetyTimeout() + lag + 1);
+  if (capture) {
+    printNewFrame();
+  }
+  dialInputProcess(printEvent);
+  
+  if (edgeRing.dropped() + captureRing.dropped() > 0) {
+    fprintf(stderr, "script: %u edges dropped\n", (unsigned)(edgeRing.dropped() + captureRing.dropped()));
+  }
+  return 0;
+}
@@ -0,0 +1,340 @@
+/*
+ * Dial simulation run
+ *
+ * Dials random digits with DialSimulator and feeds every edge through the
+ * real ISRs, edge ring and decoder on the native HAL's virtual clock, so
+ * timeouts and dial periods cost no wall time. Decoded digits are scored
+ * against the dialed ones.
+ *
+ *   program simulate digits=100000 pps=20 break=0.6 bounce_ms=3 seed=7
+ *
+ * Options (key=value): digits, seed, pps, break, jitter, spread,
+ * bounce_ms, bounce_max, windup_min_ms, windup_max_ms, skew_min_ms,
+ * skew_max_ms, stuck_shunt (1 = shunt never closes), no_shunt (1 = no shunt
+ * wired), shunt_mode (decoder DIAL_SHUNT_* mode), drop and split (chance
+ * per pulse of a missed or split pulse), spikes and spike_us (noise spikes
+ * per digit and their width), settle (1 = deferred settle sampling),
+ * counter (DIAL_COUNTER_* backend; PCNT counts every bounce, so pair
+ * counter=1 with bounce_ms=0 for the hardware-debounced line it needs),
+ * early (1 = predictive early digits), show (number of mismatches to print),
+ * telemetry=<file> (write the decoded events and the deferred log as
+ * binary telemetry frames), log (dial_log.h level, DIAL_LOG_LEVEL by default),
+ * trace=<file> (record the raw edge trace and dump it there at the end),
+ * truth=<file> (write the dialed digits, for the replay and golden tools).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "hal.h"
+#include "dial_input.h"
+#include "dial_sim.h"
+#include "host_tools.h"
+#include "telemetry.h"
+#include "edge_trace.h"
+
+// Per-digit results collected by the event handler
+static int decodedCount = 0;
+static int decodedPulses = 0;
+static uint8_t decodedFlags = 0;
+static uint64_t provisionalTime = 0;
+
+// Completion statistics
+static long timeouts = 0;
+static uint64_t digitTime = 0;
+
+// Early digit statistics
+static long provisionalConfirmed = 0;
+static long provisionalCorrected = 0;
+static double earlyLeadUs = 0;
+
+// Binary telemetry output, filtered like the firmware's
+static FILE* telemetryOut = nullptr;
+static uint8_t telemetrySeq = 0;
+static uint64_t telemetryBytes = 0;
+
+static FILE* traceOut = nullptr;
+static FILE* truthOut = nullptr;
+
+static void writeTrace(const uint8_t* data, size_t length) {
+  fwrite(data, 1, length, traceOut);
+}
+
+static void collectEvent(const DialEvent& event) {
+  if (telemetryOut && (DIAL_TELEMETRY_EVENTS & (1 << event.type))) {
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    size_t length = telemetryEncodeEvent(event, telemetrySeq++, frame, sizeof(frame));
+    fwrite(frame, 1, length, telemetryOut);
+    telemetryBytes += length;
+  }
+  if (event.type == DIAL_EVENT_PROVISIONAL) {
+    provisionalTime = event.time;
+  }
+  if ((event.type == DIAL_EVENT_RESTED || event.type == DIAL_EVENT_TIMEOUT) && event.pulses > 0) {
+    decodedCount++;
+    decodedPulses = event.pulses;
+    decodedFlags = event.flags;
+    digitTime = event.time;
+    timeouts += (event.type == DIAL_EVENT_TIMEOUT);
+    if (event.flags & DIAL_FLAG_CONFIRMED) {
+      provisionalConfirmed++;
+      earlyLeadUs += event.time - provisionalTime;
+    } else if (event.flags & DIAL_FLAG_CORRECTED) {
+      provisionalCorrected++;
+    }
+  }
+}
+
+// Decode what is queued, like loop(), and pass the deferred log on to the
+// telemetry file (or discard it)
+static void processInput() {
+  dialInputProcess(collectEvent);
+  DialLogRecord record;
+  while (dialLogRing.pop(record)) {
+    if (telemetryOut) {
+      uint8_t frame[TELEMETRY_MAX_FRAME];
+      size_t length = telemetryEncodeLog(record, telemetrySeq++, frame, sizeof(frame));
+      fwrite(frame, 1, length, telemetryOut);
+      telemetryBytes += length;
+    }
+  }
+}
+
+// Advance the virtual clock to t, stopping at every input deadline on
+// the way so timers fire at their exact time, as the one-shot timer would
+static void advanceTo(uint64_t t) {
+  uint64_t deadline = dialInputDeadline();
+  while (deadline && deadline <= t) {
+    hostSetMicros(deadline);
+    processInput();
+    uint64_t next = dialInputDeadline();
+    if (next == deadline) {
+      break;
+    }
+    deadline = next;
+  }
+  hostSetMicros(t);
+}
+
+static bool parseOption(const char* arg, const char* key, double& value) {
+  size_t length = strlen(key);
+  if (strncmp(arg, key, length) != 0 || arg[length] != '=') {
+    return false;
+  }
+  value = atof(arg + length + 1);
+  return true;
+}
+
+int runSimulate(int argc, char** argv) {
+  SimParams params;
+  double digits = 100000;
+  double seed = 1;
+  double show = 5;
+  double early = DIAL_EARLY_DIGIT;
+  double stuckShunt = 0;
+  double noShunt = 0;
+  double shuntMode = DIAL_SHUNT_MODE;
+  double settle = DIAL_SETTLE_SAMPLING;
+  double counter = DIAL_COUNTER;
+  double logLevel = DIAL_LOG_LEVEL;
+  
+  for (int i = 0; i < argc; i++) {
+    if (strncmp(argv[i], "telemetry=", 10) == 0) {
+      telemetryOut = fopen(argv[i] + 10, "wb");
+      if (!telemetryOut) {
+        fprintf(stderr, "simulate: cannot create %s\n", argv[i] + 10);
+        return 1;
+      }
+      continue;
+    }
+    if (strncmp(argv[i], "trace=", 6) == 0) {
+      traceOut = fopen(argv[i] + 6, "wb");
+      if (!traceOut) {
+        fprintf(stderr, "simulate: cannot create %s\n", argv[i] + 6);
+        return 1;
+      }
+      edgeTraceBegin(EDGE_TRACE_PSRAM_BYTES, EDGE_TRACE_RAM_BYTES);
+      continue;
+    }
+    if (strncmp(argv[i], "truth=", 6) == 0) {
+      truthOut = fopen(argv[i] + 6, "w");
+      if (!truthOut) {
+        fprintf(stderr, "simulate: cannot create %s\n", argv[i] + 6);
+        return 1;
+      }
+      continue;
+    }
+    double bounceMax = params.bounceMax;
+    bool known = parseOption(argv[i], "digits", digits)
+      || parseOption(argv[i], "seed", seed)
+      || parseOption(argv[i], "show", show)
+      || parseOption(argv[i], "early", early)
+      || parseOption(argv[i], "stuck_shunt", stuckShunt)
+      || parseOption(argv[i], "no_shunt", noShunt)
+      || parseOption(argv[i], "shunt_mode", shuntMode)
+      || parseOption(argv[i], "drop", params.dropRate)
+      || parseOption(argv[i], "split", params.splitRate)
+      || parseOption(argv[i], "spikes", params.spikesPerDigit)
+      || parseOption(argv[i], "spike_us", params.spikeUs)
+      || parseOption(argv[i], "settle", settle)
+      || parseOption(argv[i], "counter", counter)
+      || parseOption(argv[i], "log", logLevel)
+      || parseOption(argv[i], "pps", params.pulsesPerSecond)
+      || parseOption(argv[i], "break", params.breakRatio)
+      || parseOption(argv[i], "jitter", params.jitter)
+      || parseOption(argv[i], "spread", params.speedSpread)
+      || parseOption(argv[i], "bounce_ms", params.bounceMs)
+      || parseOption(argv[i], "windup_min_ms", params.windupMinMs)
+      || parseOption(argv[i], "windup_max_ms", params.windupMaxMs)
+      || parseOption(argv[i], "skew_min_ms", params.restSkewMinMs)
+      || parseOption(argv[i], "skew_max_ms", params.restSkewMaxMs);
+    if (parseOption(argv[i], "bounce_max", bounceMax)) {
+      params.bounceMax = (int)bounceMax;
+      known = true;
+    }
+    if (!known) {
+      fprintf(stderr, "simulate: unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  
+  params.shuntStuck = stuckShunt != 0;
+  params.shuntMissing = noShunt != 0;
+  DialSimulator simulator(params, (uint64_t)seed);
+  std::vector<SimEdge> edges;
+  edges.reserve(512);
+  
+  dialLogLevel = (uint8_t)logLevel;
+  dialInputSetSettleSampling(settle != 0);
+  dialInputSetCounter((uint8_t)counter);
+  dialDecoder.setEarlyDigit(early != 0);
+  dialDecoder.setShuntMode((uint8_t)shuntMode);   // Before dialInputBegin(), which pins it for PCNT
+  dialInputBegin();
+  hostSetMicros(500000);               // Outside any boot-time debounce window
+  hostSetPin(ROTARY_PULSE_PIN, LOW);   // Pulse contact is closed at rest
+  processInput();
+  
+  long correct = 0, wrong = 0, missed = 0, extra = 0;
+  long suspectRight = 0, suspectWrong = 0, repairedRight = 0, repairedWrong = 0;
+  double completionUs = 0;
+  uint64_t worstCompletionUs = 0;
+  uint64_t totalEdges = 0;
+  uint64_t now = 1000000;
+  uint32_t startIsrs = hostIsrCount();
+  
+  auto start = std::chrono::steady_clock::now();
+  
+  for (long n = 0; n < (long)digits; n++) {
+    int digit = simulator.random().below(10);
+    if (truthOut) {
+      fprintf(truthOut, (n + 1) % 50 ? "%d" : "%d\n", digit);
+    }
+    
+    edges.clear();
+    uint64_t end = simulator.generateDigit(digit, now, edges);
+    totalEdges += edges.size();
+    
+    decodedCount = 0;
+    decodedPulses = 0;
+    decodedFlags = 0;
+    uint64_t lastPulseEdge = 0;
+    for (const SimEdge& edge : edges) {
+      if (edge.pin == EDGE_PULSE) {
+        lastPulseEdge = edge.timeUs;
+      }
+    }
+    for (const SimEdge& edge : edges) {
+      advanceTo(edge.timeUs);
+      hostSetPin(edge.pin == EDGE_PULSE ? ROTARY_PULSE_PIN : ROTARY_SHUNT_PIN, edge.level);
+      processInput();
+    }
+    
+    // Jump the virtual clock past the safety timeout before the next digit
+    now = end + dialDecoder.safetyTimeout() + 1;
+    if (counter == DIAL_COUNTER_RMT) {
+      now += PULSE_CAPTURE_IDLE_US + PULSE_CAPTURE_MARGIN_US;   // Decoding runs this far behind
+    }
+    advanceTo(now);
+    processInput();
+    
+    // Time from the final pulse edge to the digit being reported
+    if (decodedCount > 0 && digitTime > lastPulseEdge) {
+      uint64_t completion = digitTime - lastPulseEdge;
+      completionUs += completion;
+      worstCompletionUs = completion > worstCompletionUs ? completion : worstCompletionUs;
+    }
+    
+    int expectedPulses = (digit == 0) ? 10 : digit;
+    if (decodedCount == 1) {
+      bool right = decodedPulses == expectedPulses;
+      if (decodedFlags & DIAL_FLAG_SUSPECT) {
+        (right ? suspectRight : suspectWrong)++;
+      }
+      if (decodedFlags & DIAL_FLAG_REPAIRED) {
+        (right ? repairedRight : repairedWrong)++;
+      }
+    }
+    
+    if (decodedCount == 0) {
+      missed++;
+    } else if (decodedCount > 1) {
+      extra++;
+    } else if (decodedPulses == expectedPulses) {
+      correct++;
+      continue;
+    } else {
+      wrong++;
+    }
+    
+    if (show > 0) {
+      show--;
+      printf("mismatch: dialed %d, decoded %d digit(s), last %d pulses%s\n",
+             digit, decodedCount, decodedPulses, (decodedFlags & DIAL_FLAG_SUSPECT) ? " (flagged)" : "");
+    }
+  }
+  
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  printf("digits:      %ld\n", (long)digits);
+  printf("correct:     %ld (%.3f%%)\n", correct, 100.0 * correct / digits);
+  printf("wrong:       %ld\n", wrong);
+  printf("missed:      %ld\n", missed);
+  printf("multiple:    %ld\n", extra);
+  printf("confidence:  %ld of %ld wrong digits flagged, %ld right digits flagged\n",
+         suspectWrong, wrong, suspectRight);
+  printf("repaired:    %ld right, %ld wrong\n", repairedRight, repairedWrong);
+  printf("edges:       %llu\n", (unsigned long long)totalEdges);
+  printf("timeouts:    %ld\n", timeouts);
+  printf("completion:  %.1f ms mean, %.1f ms worst after the last pulse edge\n",
+         completionUs / (correct + wrong + extra ? correct + wrong + extra : 1) / 1000.0, worstCompletionUs / 1000.0);
+  printf("interrupts:  %.1f per digit\n", (hostIsrCount() - startIsrs) / digits);
+  printf("ring drops:  %u\n", (unsigned)(edgeRing.dropped() + captureRing.dropped()));
+  printf("shunt:       %s\n", dialDecoder.pulseOnly() ? "not used (pulse-only)" : "wired");
+  printf("debounce:    pulse %.1f ms (bounce %.1f ms, %u leaks), shunt %.1f ms\n",
+         dialDecoder.pulseDebounce().window() / 1000.0, dialDecoder.pulseDebounce().bounceEstimate() / 1000.0,
+         (unsigned)dialDecoder.pulseDebounce().leaks(), dialDecoder.dialDebounce().window() / 1000.0);
+  if (early != 0) {
+    printf("early:       %ld confirmed, %ld corrected, %.1f ms mean lead over the shunt\n",
+           provisionalConfirmed, provisionalCorrected,
+           provisionalConfirmed ? earlyLeadUs / provisionalConfirmed / 1000.0 : 0.0);
+  }
+  if (telemetryOut) {
+    fclose(telemetryOut);
+    printf("telemetry:   %llu bytes, %.1f per digit\n", (unsigned long long)telemetryBytes, telemetryBytes / digits);
+  }
+  if (truthOut) {
+    fprintf(truthOut, "\n");
+    fclose(truthOut);
+  }
+  if (traceOut) {
+    size_t bytes = edgeTraceDump(writeTrace, halMicros());
+    fclose(traceOut);
+    size_t count = edgeTraceCount();
+    printf("trace:       %u edges, %zu bytes (%.2f per edge)\n", (unsigned)count, bytes,
+           count ? (double)edgeTraceBytes() / count : 0.0);
+  }
+  printf("wall time:   %.3f s (%.0f digits/s, %.0f s simulated)\n",
+         seconds, digits / seconds, (now - 1000000) / 1e6);
+  return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * Telemetry decoder
+ *
+ * Reads binary telemetry (telemetry.h) captured from the serial port, or
+ * written by "simulate telemetry=<file>", and prints one line per message
+ * in the same form as the script tool. Log records are formatted here from
+ * the dial_log.h table. Corrupt frames and sequence gaps are counted and
+ * reported at the end.
+ *
+ *   program telemetry <file|->
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "telemetry.h"
+#include "host_tools.h"
+
+static const char* const eventNames[] = { "none", "started", "pulse", "rested", "timeout", "provisional" };
+
+static void printMessage(const TelemetryMessage& message) {
+  if (message.type == TELEMETRY_MSG_DROPS) {
+    printf("%12s drops %u\n", "", (unsigned)message.drops);
+    return;
+  }
+  if (message.type == TELEMETRY_MSG_LOG) {
+    char text[128];
+    dialLogFormat(message.log, text, sizeof(text));
+    printf("%12.3f log %s\n", message.log.time / 1000.0, text);
+    return;
+  }
+  const DialEvent& event = message.event;
+  const char* name = event.type < sizeof(eventNames) / sizeof(eventNames[0]) ? eventNames[event.type] : "unknown";
+  printf("%12.3f %s", event.time / 1000.0, name);
+  if (event.type != DIAL_EVENT_STARTED) {
+    printf(" %d", event.pulses);
+  }
+  if (event.type == DIAL_EVENT_RESTED || event.type == DIAL_EVENT_TIMEOUT || event.type == DIAL_EVENT_PROVISIONAL) {
+    printf(" digit %d", pulsesToDigit(event.pulses));
+  }
+  if (event.line) {
+    printf(" line %d", event.line);
+  }
+  if (event.flags) {
+    printf(" flags 0x%02x confidence %d", event.flags, event.confidence);
+  }
+  printf("\n");
+}
+
+int runTelemetry(int argc, char** argv) {
+  if (argc < 1) {
+    fprintf(stderr, "telemetry: missing file argument\n");
+    return 2;
+  }
+  FILE* in = strcmp(argv[0], "-") == 0 ? stdin : fopen(argv[0], "rb");
+  if (!in) {
+    fprintf(stderr, "telemetry: cannot open %s\n", argv[0]);
+    return 1;
+  }
+  
+  TelemetryDecoder decoder;
+  TelemetryMessage message;
+  int c;
+  while ((c = fgetc(in)) != EOF) {
+    if (decoder.feed((uint8_t)c, message)) {
+      printMessage(message);
+    }
+  }
+  if (in != stdin) fclose(in);
+  
+  fprintf(stderr, "telemetry: %u frames, %u bad, %u lost\n",
+          (unsigned)decoder.frames(), (unsigned)decoder.badFrames(), (unsigned)decoder.lost());
+  return decoder.badFrames() || decoder.lost() ? 1 : 0;
+}
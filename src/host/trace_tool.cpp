@@ -0,0 +1,65 @@
+/*
+ * Edge trace reader
+ *
+ * Finds a trace dump (edge_trace.h) in a file - a raw serial capture with
+ * console text around it is fine - checks it and prints its edges in time
+ * order as a script for the script tool:
+ *
+ *   program trace capture.bin > edges.txt
+ *   program trace capture.bin | program script -
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "edge_trace.h"
+#include "host_tools.h"
+
+int runTrace(int argc, char** argv) {
+  if (argc < 1) {
+    fprintf(stderr, "trace: missing file argument\n");
+    return 2;
+  }
+  FILE* in = strcmp(argv[0], "-") == 0 ? stdin : fopen(argv[0], "rb");
+  if (!in) {
+    fprintf(stderr, "trace: cannot open %s\n", argv[0]);
+    return 1;
+  }
+  std::vector<uint8_t> data;
+  int c;
+  while ((c = fgetc(in)) != EOF) {
+    data.push_back((uint8_t)c);
+  }
+  if (in != stdin) fclose(in);
+  
+  // The first dump that decodes and whose CRC checks out
+  for (size_t start = 0; start + EDGE_TRACE_HEADER_SIZE + 2 <= data.size(); start++) {
+    if (memcmp(&data[start], EDGE_TRACE_MAGIC, 4) != 0) {
+      continue;
+    }
+    EdgeTraceReader reader;
+    std::vector<EdgeEvent> edges;
+    EdgeEvent edge;
+    for (size_t i = start; i < data.size() && !reader.finished() && !reader.failed(); i++) {
+      if (reader.feed(data[i], edge)) {
+        edges.push_back(edge);
+      }
+    }
+    if (!reader.ok() || edges.size() != reader.edgeCount()) {
+      continue;
+    }
+    std::stable_sort(edges.begin(), edges.end(),
+                     [](const EdgeEvent& a, const EdgeEvent& b) { return a.time < b.time; });
+    
+    printf("# edge trace: %u edges, %u lost, dumped at %.3f ms\n",
+           (unsigned)edges.size(), (unsigned)reader.lost(), reader.dumpTime() / 1000.0);
+    for (const EdgeEvent& edge : edges) {
+      printf("%.3f %s %d\n", edge.time / 1000.0, edge.pin == EDGE_PULSE ? "pulse" : "shunt", edge.level);
+    }
+    return 0;
+  }
+  
+  fprintf(stderr, "trace: no valid trace dump found\n");
+  return 1;
+}
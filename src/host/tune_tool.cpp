@@ -0,0 +1,288 @@
+/*
+ * Timing autotuner
+ *
+ * Replays the ISR path entries of a trace corpus (replay.h) through the
+ * decoder for every combination of timing values on a grid, spread over
+ * all cores with a work-stealing pool, and prints the Pareto front of
+ * accuracy against completion latency: the settings that no other setting
+ * beats on both.
+ * The chosen one is exported as a header (built in as src/dial_tuning.h)
+ * or as an NVS profile (dial_profile.h).
+ *
+ *   program tune corpus/golden.txt pulse_db_us=5000:25000:5000 timeout_periods=2
+ *   program tune corpus/golden.txt min_accuracy=99 header=src/dial_tuning.h nvs=profile.csv
+ *
+ * Axes are named by their NVS keys and given as lo:hi:step or a single
+ * value; the rest keep their default grids. Accuracy counts false digits
+ * against the setting (correct / (dialed + false)); latency is the mean
+ * from the last pulse edge to the digit (the 99th percentile is shown too,
+ * but the slowest digits wait for their shunt whatever the timing).
+ * min_accuracy picks the
+ * fastest front setting at least that accurate, otherwise the most
+ * accurate one is chosen. threads=<n> overrides one worker per core.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "dial_profile.h"
+#include "replay.h"
+#include "work_pool.h"
+#include "host_tools.h"
+
+struct TuneAxis {
+  const char* key;
+  uint32_t DialTiming::*field;
+  uint32_t lo, hi, step;
+};
+
+// Default grids around the dial_config.h values. The safety timeout only
+// matters for digits that never see a pulse, so it is not swept by default.
+static TuneAxis axes[] = {
+  { "pulse_db_us",     &DialTiming::pulseDebounceUs, 3000,  25000,  2000 },
+  { "dial_db_us",      &DialTiming::dialDebounceUs,  10000, 50000,  5000 },
+  { "timeout_us",      &DialTiming::timeoutUs,       DIAL_TIMEOUT_US, DIAL_TIMEOUT_US, 1 },
+  { "timeout_min_us",  &DialTiming::timeoutMinUs,    50000, 200000, 25000 },
+  { "timeout_periods", &DialTiming::timeoutPeriods,  1,     3,      1 },
+};
+#define TUNE_AXES (sizeof(axes) / sizeof(axes[0]))
+
+struct TuneResult {
+  DialTiming timing;
+  long correct;
+  long dialed;
+  long falseDigits;
+  double accuracy;       // Percent, false digits counted against it
+  double latencyMs;      // Mean
+  double p99LatencyMs;
+};
+
+// Per-worker buffers, reused across tasks
+struct TuneScratch {
+  std::vector<ReplayDigit> decoded;
+  std::vector<uint32_t> latencies;
+};
+
+static bool parseAxis(const char* arg) {
+  for (TuneAxis& axis : axes) {
+    size_t length = strlen(axis.key);
+    if (strncmp(arg, axis.key, length) != 0 || arg[length] != '=') {
+      continue;
+    }
+    unsigned long lo, hi, step;
+    int fields = sscanf(arg + length + 1, "%lu:%lu:%lu", &lo, &hi, &step);
+    if (fields == 1) {
+      hi = lo;
+      step = 1;
+    } else if (fields != 3 || step == 0 || hi < lo) {
+      return false;
+    }
+    axis.lo = (uint32_t)lo;
+    axis.hi = (uint32_t)hi;
+    axis.step = (uint32_t)step;
+    return true;
+  }
+  return false;
+}
+
+static size_t axisSize(const TuneAxis& axis) {
+  return (axis.hi - axis.lo) / axis.step + 1;
+}
+
+// Grid point index as one value per axis, first axis varying slowest
+static DialTiming gridTiming(size_t index) {
+  DialTiming timing;
+  for (int i = TUNE_AXES - 1; i >= 0; i--) {
+    size_t size = axisSize(axes[i]);
+    timing.*axes[i].field = axes[i].lo + (uint32_t)(index % size) * axes[i].step;
+    index /= size;
+  }
+  return timing;
+}
+
+static void evaluate(const ReplayCorpus& corpus, TuneResult& result, TuneScratch& scratch) {
+  result.correct = result.dialed = result.falseDigits = 0;
+  scratch.latencies.clear();
+  double latencySum = 0;
+  for (const ReplayTrace& trace : corpus.traces) {
+    DialDecoder decoder;
+    decoder.setTiming(result.timing);
+    scratch.decoded.clear();
+    replayDecode(decoder, trace.edges, scratch.decoded);
+    ReplayScore score;
+    replayScore(trace.dialed, scratch.decoded, score);
+    result.correct += score.correct;
+    result.dialed += score.expected;
+    result.falseDigits += score.falseDigits;
+    for (const ReplayDigit& digit : scratch.decoded) {
+      scratch.latencies.push_back(digit.latencyUs);
+      latencySum += digit.latencyUs;
+    }
+  }
+  
+  long total = result.dialed + result.falseDigits;
+  result.accuracy = total ? 100.0 * result.correct / total : 100.0;
+  if (scratch.latencies.empty()) {
+    result.latencyMs = result.p99LatencyMs = 0;
+    return;
+  }
+  size_t p99 = (size_t)(0.99 * (scratch.latencies.size() - 1) + 0.5);
+  std::nth_element(scratch.latencies.begin(), scratch.latencies.begin() + p99, scratch.latencies.end());
+  result.p99LatencyMs = scratch.latencies[p99] / 1000.0;
+  result.latencyMs = latencySum / scratch.latencies.size() / 1000.0;
+}
+
+static void printTiming(const DialTiming& timing) {
+  printf("%7.1f %7.1f %8.0f %7.0f %4u", timing.pulseDebounceUs / 1000.0, timing.dialDebounceUs / 1000.0,
+         timing.timeoutUs / 1000.0, timing.timeoutMinUs / 1000.0, (unsigned)timing.timeoutPeriods);
+}
+
+static bool exportHeader(const char* path, const char* manifest, const TuneResult& chosen) {
+  FILE* out = fopen(path, "w");
+  if (!out) {
+    return false;
+  }
+  fprintf(out, "/*\n * Dial Tuning\n *\n");
+  fprintf(out, " * Generated by \"program tune %s\": %.2f%% accurate over %ld dialed\n", manifest,
+          chosen.accuracy, chosen.dialed);
+  fprintf(out, " * digits, %.1f ms mean completion latency. Overrides dial_config.h.\n */\n\n", chosen.latencyMs);
+  fprintf(out, "#pragma once\n\n");
+#define TUNE_X_DEFINE(field, key, constant) \
+  fprintf(out, "#define %s %lu\n", #constant, (unsigned long)chosen.timing.field);
+  DIAL_PROFILE_FIELDS(TUNE_X_DEFINE)
+#undef TUNE_X_DEFINE
+  fclose(out);
+  return true;
+}
+
+// CSV for ESP-IDF's nvs_partition_gen.py
+static bool exportNvs(const char* path, const TuneResult& chosen) {
+  FILE* out = fopen(path, "w");
+  if (!out) {
+    return false;
+  }
+  fprintf(out, "key,type,encoding,value\n");
+  fprintf(out, "%s,namespace,,\n", DIAL_PROFILE_NAMESPACE);
+#define TUNE_X_ENTRY(field, key, constant) \
+  fprintf(out, "%s,data,u32,%lu\n", key, (unsigned long)chosen.timing.field);
+  DIAL_PROFILE_FIELDS(TUNE_X_ENTRY)
+#undef TUNE_X_ENTRY
+  fclose(out);
+  return true;
+}
+
+int runTune(int argc, char** argv) {
+  const char* manifest = "corpus/golden.txt";
+  const char* headerPath = nullptr;
+  const char* nvsPath = nullptr;
+  double minAccuracy = -1;
+  unsigned threads = 0;
+  for (int i = 0; i < argc; i++) {
+    if (strncmp(argv[i], "header=", 7) == 0) {
+      headerPath = argv[i] + 7;
+    } else if (strncmp(argv[i], "nvs=", 4) == 0) {
+      nvsPath = argv[i] + 4;
+    } else if (strncmp(argv[i], "min_accuracy=", 13) == 0) {
+      minAccuracy = atof(argv[i] + 13);
+    } else if (strncmp(argv[i], "threads=", 8) == 0) {
+      threads = (unsigned)atoi(argv[i] + 8);
+    } else if (strchr(argv[i], '=')) {
+      if (!parseAxis(argv[i])) {
+        fprintf(stderr, "tune: bad option %s\n", argv[i]);
+        return 2;
+      }
+    } else {
+      manifest = argv[i];
+    }
+  }
+  
+  ReplayCorpus corpus;
+  if (!replayLoadCorpus(manifest, corpus)) {
+    return 1;
+  }
+  
+  // The workers call the decoder directly, which is what the ISR path
+  // decodes; the other paths run through dial_input.cpp's globals and
+  // only repeat traces already listed
+  corpus.traces.erase(std::remove_if(corpus.traces.begin(), corpus.traces.end(),
+                                     [](const ReplayTrace& trace) {
+                                       return trace.input.settle || trace.input.counter != DIAL_COUNTER_ISR;
+                                     }),
+                      corpus.traces.end());
+  size_t points = 1;
+  for (const TuneAxis& axis : axes) {
+    points *= axisSize(axis);
+  }
+  
+  std::vector<TuneResult> results(points);
+  WorkStealingPool pool(threads);
+  std::vector<TuneScratch> scratch(pool.threads());
+  auto start = std::chrono::steady_clock::now();
+  pool.run(points, [&](size_t task, unsigned worker) {
+    results[task].timing = gridTiming(task);
+    evaluate(corpus, results[task], scratch[worker]);
+  });
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  // Pareto front: by latency, keeping each setting more accurate than
+  // every faster one
+  std::vector<size_t> order(points);
+  for (size_t i = 0; i < points; i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (results[a].latencyMs != results[b].latencyMs) {
+      return results[a].latencyMs < results[b].latencyMs;
+    }
+    return results[a].accuracy > results[b].accuracy;
+  });
+  std::vector<size_t> front;
+  for (size_t index : order) {
+    if (front.empty() || results[index].accuracy > results[front.back()].accuracy) {
+      front.push_back(index);
+    }
+  }
+  
+  printf("%zu settings x %zu traces on %u threads in %.2f s (%zu steals)\n\n", points, corpus.traces.size(),
+         pool.threads(), seconds, pool.steals());
+  printf("Pareto front (ms):\n");
+  printf("pulse_db dial_db timeout tmo_min per  accuracy  false  mean ms  p99 ms\n");
+  for (size_t index : front) {
+    const TuneResult& result = results[index];
+    printTiming(result.timing);
+    printf("  %7.2f%%  %5ld  %7.1f  %6.1f\n", result.accuracy, result.falseDigits, result.latencyMs,
+           result.p99LatencyMs);
+  }
+  
+  const TuneResult* chosen = &results[front.back()];
+  if (minAccuracy >= 0) {
+    chosen = nullptr;
+    for (size_t index : front) {
+      if (results[index].accuracy >= minAccuracy) {
+        chosen = &results[index];
+        break;
+      }
+    }
+    if (!chosen) {
+      fprintf(stderr, "tune: no setting reaches %.2f%%\n", minAccuracy);
+      return 1;
+    }
+  }
+  printf("\nchosen:\n");
+  printTiming(chosen->timing);
+  printf("  %7.2f%%  %5ld  %7.1f  %6.1f\n", chosen->accuracy, chosen->falseDigits, chosen->latencyMs,
+         chosen->p99LatencyMs);
+  
+  if (headerPath && !exportHeader(headerPath, manifest, *chosen)) {
+    fprintf(stderr, "tune: cannot create %s\n", headerPath);
+    return 1;
+  }
+  if (nvsPath && !exportNvs(nvsPath, *chosen)) {
+    fprintf(stderr, "tune: cannot create %s\n", nvsPath);
+    return 1;
+  }
+  return 0;
+}
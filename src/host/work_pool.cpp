@@ -0,0 +1,64 @@
+/*
+ * Work-Stealing Pool - see work_pool.h
+ */
+
+#include "work_pool.h"
+#include <thread>
+
+static unsigned workerCount(unsigned threads) {
+  if (threads) {
+    return threads;
+  }
+  unsigned cores = std::thread::hardware_concurrency();
+  return cores ? cores : 1;   // 0 if it cannot tell
+}
+
+WorkStealingPool::WorkStealingPool(unsigned threads) : threads_(workerCount(threads)), queues_(threads_) {
+}
+
+// Next task for worker: its own newest, else the oldest of another's
+bool WorkStealingPool::take(unsigned worker, size_t& task) {
+  {
+    Queue& own = queues_[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = own.tasks.back();
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (unsigned i = 1; i < threads_; i++) {
+    Queue& victim = queues_[(worker + i) % threads_];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.front();
+      victim.tasks.pop_front();
+      std::lock_guard<std::mutex> count(stealMutex_);
+      steals_++;
+      return true;
+    }
+  }
+  return false;   // Nothing is added during a run, so all work is taken
+}
+
+void WorkStealingPool::run(size_t count, const std::function<void(size_t task, unsigned worker)>& task) {
+  steals_ = 0;
+  for (size_t i = 0; i < count; i++) {
+    queues_[i % threads_].tasks.push_back(i);
+  }
+  
+  auto work = [&](unsigned worker) {
+    size_t next;
+    while (take(worker, next)) {
+      task(next, worker);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned worker = 1; worker < threads_; worker++) {
+    workers.emplace_back(work, worker);
+  }
+  work(0);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
@@ -0,0 +1,42 @@
+/*
+ * Work-Stealing Pool
+ *
+ * Runs a batch of independent tasks across all cores. Task indices are
+ * dealt out round robin to per-worker deques; each worker takes from the
+ * back of its own deque and, when it runs dry, steals from the front of
+ * the others'. Tasks of very different cost (a slow parameter set, a long
+ * trace) then balance without a shared queue every worker contends on.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class WorkStealingPool {
+public:
+  explicit WorkStealingPool(unsigned threads = 0);   // 0: one per core
+
+  // Run task(i) for every i in [0, count) and wait for all of them.
+  // task(i, worker) gets the worker index for per-worker scratch state.
+  void run(size_t count, const std::function<void(size_t task, unsigned worker)>& task);
+
+  unsigned threads() const { return threads_; }
+  size_t steals() const { return steals_; }   // In the last run()
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  bool take(unsigned worker, size_t& task);
+
+  unsigned threads_;
+  std::vector<Queue> queues_;
+  size_t steals_ = 0;
+  std::mutex stealMutex_;
+};
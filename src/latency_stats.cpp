@@ -0,0 +1,85 @@
+/*
+ * Latency Statistics - see latency_stats.h
+ */
+
+#include "latency_stats.h"
+#include <stdio.h>
+
+LatencyHistogram latencyStats[LATENCY_STAGE_COUNT];
+const char* const latencyStageNames[LATENCY_STAGE_COUNT] = { "accept", "decision", "output" };
+
+int LatencyHistogram::bucketIndex(uint32_t us) {
+  if (us < LATENCY_SUB_BUCKETS) {
+    return us;
+  }
+  int msb = 31 - __builtin_clz(us);
+  int sub = (us >> (msb - 2)) & (LATENCY_SUB_BUCKETS - 1);
+  return (msb - 1) * LATENCY_SUB_BUCKETS + sub;
+}
+
+uint32_t LatencyHistogram::bucketUpperBound(int index) {
+  if (index < LATENCY_SUB_BUCKETS) {
+    return index;
+  }
+  int msb = index / LATENCY_SUB_BUCKETS + 1;
+  int sub = index % LATENCY_SUB_BUCKETS;
+  uint64_t lower = (uint64_t)(LATENCY_SUB_BUCKETS + sub) << (msb - 2);
+  uint64_t upper = lower + (1ull << (msb - 2)) - 1;
+  return upper > 0xFFFFFFFFull ? 0xFFFFFFFF : (uint32_t)upper;
+}
+
+void LatencyHistogram::record(uint32_t us) {
+  buckets_[bucketIndex(us)]++;
+  count_++;
+  if (us > max_) {
+    max_ = us;
+  }
+}
+
+void LatencyHistogram::reset() {
+  *this = LatencyHistogram();
+}
+
+uint32_t LatencyHistogram::percentile(uint32_t permille) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  
+  // Rank of the requested sample, rounded up (p100 = last sample)
+  uint64_t rank = ((uint64_t)count_ * permille + 999) / 1000;
+  if (rank == 0) {
+    rank = 1;
+  }
+  
+  uint64_t seen = 0;
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      uint32_t bound = bucketUpperBound(i);
+      return bound < max_ ? bound : max_;
+    }
+  }
+  return max_;
+}
+
+int LatencyHistogram::format(char* out, size_t size, const char* name) const {
+  return snprintf(out, size, "%s n=%u p50=%u p99=%u max=%u us",
+                  name, (unsigned)count_, (unsigned)percentile(500),
+                  (unsigned)percentile(990), (unsigned)max_);
+}
+
+int LatencyHistogram::formatBuckets(char* out, size_t size, const char* name) const {
+  int length = snprintf(out, size, "%s", name);
+  for (int i = 0; i < LATENCY_BUCKETS && length >= 0 && (size_t)length < size; i++) {
+    if (buckets_[i]) {
+      length += snprintf(out + length, size - length, " %d:%u", i, (unsigned)buckets_[i]);
+    }
+  }
+  return length;
+}
+
+void latencyReset() {
+  for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+    latencyStats[stage].reset();
+  }
+}
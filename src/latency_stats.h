@@ -0,0 +1,64 @@
+/*
+ * Latency Statistics
+ *
+ * Log-bucketed latency histograms for the edge-to-digit path. Each stage
+ * is measured from the raw edge timestamp taken in the ISR:
+ *
+ *   LATENCY_ACCEPT    edge -> accepted by the debouncer (any dial event)
+ *   LATENCY_DECISION  edge -> digit decided (shunt back at rest)
+ *   LATENCY_OUTPUT    edge -> digit output flushed to the serial port (only
+ *                     while output timing is on, as flushing stalls loop())
+ *
+ * Buckets split every power of two into four, so any reported value is
+ * within 25% of the true one while a histogram stays a fixed 512 bytes.
+ * Recording and querying both happen on the consumer task.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LATENCY_SUB_BUCKETS 4                          // Buckets per power of two
+#define LATENCY_BUCKETS (32 * LATENCY_SUB_BUCKETS)     // Covers the full uint32_t range
+
+enum LatencyStage : uint8_t {
+  LATENCY_ACCEPT = 0,
+  LATENCY_DECISION,
+  LATENCY_OUTPUT,
+  LATENCY_STAGE_COUNT
+};
+
+class LatencyHistogram {
+public:
+  void record(uint32_t us);
+  void reset();
+
+  uint32_t count() const { return count_; }
+  uint32_t max() const { return max_; }
+
+  // Upper bound of the bucket holding the given percentile (0-1000 per mille)
+  uint32_t percentile(uint32_t permille) const;
+
+  // Compact one-line summary / raw non-empty buckets ("index:count ...")
+  int format(char* out, size_t size, const char* name) const;
+  int formatBuckets(char* out, size_t size, const char* name) const;
+
+  static int bucketIndex(uint32_t us);
+  static uint32_t bucketUpperBound(int index);
+
+private:
+  uint32_t buckets_[LATENCY_BUCKETS] = {};
+  uint32_t count_ = 0;
+  uint32_t max_ = 0;
+};
+
+extern LatencyHistogram latencyStats[LATENCY_STAGE_COUNT];
+extern const char* const latencyStageNames[LATENCY_STAGE_COUNT];
+
+inline void latencyRecord(LatencyStage stage, uint64_t edgeTime, uint64_t now) {
+  uint64_t us = now - edgeTime;
+  latencyStats[stage].record(us > 0xFFFFFFFFull ? 0xFFFFFFFF : (uint32_t)us);
+}
+
+void latencyReset();
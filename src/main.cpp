@@ -11,14 +11,29 @@
  * Features:
  * - Counts pulses on HIGH transitions for reliability
  * - Uses shunt switch for immediate completion detection
- * - Proper debouncing (20ms pulse, 50ms shunt)
- * - Safety timeout backup (3 seconds)
- * - Works with both 3-wire and 4-wire rotary dials
+ * - Proper debouncing (15ms pulse, 50ms shunt, microsecond timestamps)
+ * - Adaptive completion timeout when the shunt never closes: a few learned
+ *   pulse periods (DIAL_TIMEOUT_PERIODS, at least DIAL_TIMEOUT_MIN_US), with
+ *   the safety timeout (twice DIAL_TIMEOUT_US, 3 s) as the fallback
+ * - Works with both 3-wire and 4-wire rotary dials (pulse-only mode ends
+ *   digits on the pulse gap; the shunt is detected automatically)
+ * - ISRs only queue timestamped edges; decoding and printing run in loop()
+ * - Optional settle sampling for noisy lines (DIAL_SETTLE_SAMPLING)
+ * - loop() sleeps until an edge or the safety timer wakes it (no polling)
+ * - Optional early digits from the learned pulse period (DIAL_EARLY_DIGIT)
+ * - Edge-to-digit latency histograms (press 'l' in the Serial Monitor)
+ * - Pulse counts cross-checked against pulse timing; doubtful digits are
+ *   marked "?" and a clearly missed or split pulse is repaired
+ * - Optional binary telemetry for a supervising host (DIAL_TELEMETRY, 't' key)
+ * - Deferred log of ISR/timer diagnostics, formatted in loop() ('v' key)
+ * - Raw edge trace in PSRAM, dumped for host replay ('d' key, EDGE_TRACE)
+ * - Decoder timing from an NVS profile picked by the host tune tool
+ * - Optional eight-line switchboard decoded from DMA bus capture (S3)
  * 
  * How to use:
  * 1. Connect your rotary dial according to the wiring diagram in README.md
  * 2. Upload this sketch to your ESP32
- * 3. Open Serial Monitor at 115200 baud
+ * 3. Open Serial Monitor on the board's native USB port
  * 4. Dial digits and watch the output
  * 
  * Expected behavior:
@@ -30,99 +45,325 @@
  */
 
 #include <Arduino.h>
+#include "dial_input.h"
+#include "bus_capture.h"
+#include "dial_bank.h"
+#include "hal.h"
+#include "dial_log.h"
+#include "dial_profile.h"
+#include "edge_trace.h"
+#include "latency_stats.h"
+#include "telemetry.h"
 
-// Pin definitions (same as RetroBell project)
-#define ROTARY_PULSE_PIN 15   // Pulse switch (counts rotations)
-#define ROTARY_SHUNT_PIN 14   // Shunt/off-normal switch (active while dialing)
+// Output format, switched with the 't' key
+static bool binaryTelemetry = DIAL_TELEMETRY == DIAL_TELEMETRY_BINARY;
+static uint8_t telemetrySeq = 0;
 
-// Dial detection variables (simplified like working sketch)
-volatile int pulseCount = 0;
-volatile bool dialing = false;
-volatile unsigned long lastPulseTime = 0;
-volatile unsigned long dialingTimeout = 0;
+// The output stage is timed by waiting for the port to drain, which would
+// hold loop() up on every digit, so it is only measured on request ('o')
+static bool outputTiming = false;
 
-// State tracking
-volatile bool lastDialState = HIGH;
-volatile bool lastPulseState = HIGH;
+// Digits decoded while a trace dump holds the port, printed once it ends
+static SpscRing<DialEvent, 32> heldEvents;
 
-// Timing constants (based on working Arduino sketch)
-#define PULSE_DEBOUNCE_MS 20         // Debounce time for pulse switch
-#define DIAL_DEBOUNCE_MS 50          // Debounce time for dial switch  
-#define DIAL_TIMEOUT_MS 1500         // Time after last pulse to consider dialing complete
+void recordOutputLatency(const DialEvent& event) {
+  if (outputTiming) {
+    Serial.flush();
+    latencyRecord(LATENCY_OUTPUT, event.time, halMicros());
+  }
+}
 
-// Interrupt Service Routines (simplified approach like working sketch)
-void IRAM_ATTR onPulse() {
-  unsigned long now = millis();
-  
-  // Debounce
-  static unsigned long lastPulseDebounce = 0;
-  if (now - lastPulseDebounce < PULSE_DEBOUNCE_MS) {
+void printDigit(const DialEvent& event) {
+  Serial.println();
+  if (event.line) {
+    Serial.print("[Line ");
+    Serial.print(event.line);
+    Serial.print("] ");
+  }
+  Serial.print((event.flags & DIAL_FLAG_SUSPECT) ? "? Digit dialed: " : "✓ Digit dialed: ");
+  Serial.print(pulsesToDigit(event.pulses));
+  Serial.print(" (");
+  Serial.print(event.pulses);
+  Serial.print(" pulses");
+  if (event.flags & DIAL_FLAG_REPAIRED) {
+    Serial.print(", repaired from pulse timing");
+  }
+  if (event.flags & (DIAL_FLAG_SUSPECT | DIAL_FLAG_REPAIRED)) {
+    Serial.print(", confidence ");
+    Serial.print(event.confidence);
+    Serial.print("%");
+  }
+  Serial.println(")");
+  Serial.println();
+}
+
+// One binary frame per selected event, written in a single call
+void sendTelemetry(const DialEvent& event) {
+  if (!(DIAL_TELEMETRY_EVENTS & (1 << event.type))) {
     return;
   }
-  
-  bool currentPulseState = digitalRead(ROTARY_PULSE_PIN);
-  if (currentPulseState != lastPulseState) {
-    lastPulseDebounce = now;
-    
-    // Count on HIGH transitions (like working Arduino sketch)
-    if (dialing && currentPulseState == HIGH) {
-      pulseCount++;
-      lastPulseTime = now;
-      dialingTimeout = now;  // Reset timeout on each pulse
-    }
-    
-    lastPulseState = currentPulseState;
+  uint8_t frame[TELEMETRY_MAX_FRAME];
+  size_t length = telemetryEncodeEvent(event, telemetrySeq++, frame, sizeof(frame));
+  Serial.write(frame, length);
+  if (event.type == DIAL_EVENT_RESTED && event.pulses > 0) {
+    recordOutputLatency(event);
   }
 }
 
-void IRAM_ATTR onShuntChange() {
-  unsigned long now = millis();
-  
-  // Debounce
-  static unsigned long lastDialDebounce = 0;
-  if (now - lastDialDebounce < DIAL_DEBOUNCE_MS) {
+void handleDialEvent(const DialEvent& event) {
+  if (edgeTraceDumping()) {
+    heldEvents.push(event);
+    return;
+  }
+  if (binaryTelemetry) {
+    sendTelemetry(event);
     return;
   }
   
-  bool currentDialState = digitalRead(ROTARY_SHUNT_PIN);
-  if (currentDialState != lastDialState) {
-    lastDialDebounce = now;
-    
-    // Start dialing when shunt goes LOW
-    if (!dialing && currentDialState == LOW) {
-      dialing = true;
-      pulseCount = 0;
-      dialingTimeout = now;
+  switch (event.type) {
+    case DIAL_EVENT_STARTED:
       Serial.println("\n[Dial started turning]");
-    }
-    // End dialing when shunt goes HIGH (dial returned to rest)
-    else if (dialing && currentDialState == HIGH) {
-      dialing = false;
-      Serial.println("\n[Dial returned to rest]");
+      break;
+      
+    case DIAL_EVENT_PULSE:
+      // Show dots for visual feedback
+      Serial.print(".");
+      Serial.print("[");
+      Serial.print(event.pulses);
+      Serial.print("]");
+      break;
       
-      // Process the digit immediately when dial returns to rest
-      if (pulseCount > 0) {
-        // Convert pulse count to digit (10 pulses = 0)
-        int digit = (pulseCount == 10) ? 0 : pulseCount;
-        
-        Serial.println();
-        Serial.print("✓ Digit dialed: ");
-        Serial.print(digit);
-        Serial.print(" (");
-        Serial.print(pulseCount);
-        Serial.println(" pulses)");
-        Serial.println();
+    case DIAL_EVENT_PROVISIONAL:
+      // Pulse gap says the digit is over; the shunt will confirm it
+      printDigit(event);
+      break;
+      
+    case DIAL_EVENT_RESTED:
+    case DIAL_EVENT_TIMEOUT:
+      // A timeout means the shunt never closed - something went wrong
+      Serial.println(event.type == DIAL_EVENT_RESTED ? "\n[Dial returned to rest]"
+                                                     : "\n[Safety timeout - dial may be stuck]");
+      if (event.flags & DIAL_FLAG_CONFIRMED) {
+        break;  // Already reported early
+      }
+      if (event.flags & DIAL_FLAG_CORRECTED) {
+        Serial.println("[Correction - early digit was wrong]");
+      }
+      if (event.pulses > 0) {
+        printDigit(event);
+        recordOutputLatency(event);
       }
+      break;
+      
+    default:
+      break;
+  }
+}
+
+// Switchboard dials on the bus capture (DIAL_BUS_CAPTURE), reported as
+// lines 1-8 next to the single dial's line 0
+static DialBank busBank;
+static bool busRunning = false;
+
+void onBusDigit(int line, int pulses, void*) {
+  DialEvent event = { DIAL_EVENT_RESTED, (uint8_t)pulses, halMicros(), (uint8_t)(line + 1), 0, 100 };
+  if (binaryTelemetry) {
+    sendTelemetry(event);
+  } else if (edgeTraceDumping()) {
+    heldEvents.push(event);
+  } else {
+    printDigit(event);
+  }
+}
+
+// Decode every buffer the DMA has filled since the last call
+void drainBus() {
+  const uint16_t* samples;
+  while ((samples = busCaptureTake()) != nullptr) {
+    busBank.sampleBlock<uint16_t>(samples, DIAL_BUS_BUFFER_SAMPLES, onBusDigit, nullptr);
+  }
+  if (edgeTraceDumping()) {
+    return;   // Overruns are reported once the dump is out
+  }
+  static uint32_t lastOverruns = 0;
+  uint32_t overruns = busCaptureOverruns();
+  if (overruns != lastOverruns && !binaryTelemetry) {
+    Serial.print("\n[Bus capture: ");
+    Serial.print(overruns);
+    Serial.println(" buffers taken too late]");
+  }
+  lastOverruns = overruns;
+}
+
+void printLatencyStats(bool buckets) {
+  char line[LATENCY_BUCKETS * 12];
+  Serial.println("\n[Latency from raw edge]");
+  for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+    if (buckets) {
+      latencyStats[stage].formatBuckets(line, sizeof(line), latencyStageNames[stage]);
+    } else {
+      latencyStats[stage].format(line, sizeof(line), latencyStageNames[stage]);
     }
-    
-    lastDialState = currentDialState;
+    Serial.print("  ");
+    Serial.println(line);
   }
 }
 
-void setup() {
-  Serial.begin(115200);
-  delay(1000);
+// Level durations of the last RMT frame, as captured (DIAL_COUNTER_RMT)
+void printLastFrame() {
+  static PulseSymbol symbols[PULSE_CAPTURE_MAX_SYMBOLS];
+  size_t count = 0;
+  uint32_t frames = dialInputLastFrame(symbols, PULSE_CAPTURE_MAX_SYMBOLS, &count);
+  Serial.print("\n[Capture frame ");
+  Serial.print(frames);
+  Serial.print(": ");
+  Serial.print((unsigned)count);
+  Serial.println(" symbols]");
+  for (size_t i = 0; i < 2 * count; i++) {
+    uint32_t ticks = (i & 1) ? symbols[i / 2].duration1 : symbols[i / 2].duration0;
+    int level = (i & 1) ? symbols[i / 2].level1 : symbols[i / 2].level0;
+    if (ticks == 0) {
+      break;
+    }
+    Serial.print(level ? "  HIGH " : "  LOW  ");
+    Serial.print(ticks * PULSE_CAPTURE_TICK_US / 1000.0, 3);
+    Serial.println(" ms");
+  }
+}
+
+// Format or forward what the ISRs and timers logged since the last call
+void drainLog() {
+  DialLogRecord record;
+  while (dialLogRing.pop(record)) {
+    if (binaryTelemetry) {
+      uint8_t frame[TELEMETRY_MAX_FRAME];
+      Serial.write(frame, telemetryEncodeLog(record, telemetrySeq++, frame, sizeof(frame)));
+    } else {
+      char text[128];
+      dialLogFormat(record, text, sizeof(text));
+      Serial.print("\n[log ");
+      Serial.print((uint32_t)(record.time / 1000));
+      Serial.print(" ms] ");
+      Serial.println(text);
+    }
+  }
+}
+
+void writeSerial(const uint8_t* data, size_t length) {
+  Serial.write(data, length);
+}
+
+// Start sending the raw edge trace as one binary trace file (see
+// edge_trace.h); loop() sends it piece by piece
+void dumpTrace() {
+  Serial.print("\n[Trace dump: ");
+  Serial.print((unsigned)edgeTraceCount());
+  Serial.println(" edges]");
+  edgeTraceDumpBegin(halMicros());
+}
+
+// Send as much of a running dump as the port takes without blocking, so
+// loop() keeps decoding in between; once it is out, print what was held.
+// Returns true while the dump goes on.
+bool sendTraceDump() {
+  int room = Serial.availableForWrite();
+  if (room > 0) {
+    edgeTraceDumpStep(writeSerial, room);
+  }
+  if (edgeTraceDumping()) {
+    if (room <= 0) {
+      delay(1);   // Port full: let it drain
+    }
+    halNotifyConsumer();   // Come back for the next piece
+    return true;
+  }
   
+  Serial.println("\n[Trace dump end]");
+  DialEvent event;
+  while (heldEvents.pop(event)) {
+    if (event.line) {
+      printDigit(event);   // Bus line
+    } else {
+      handleDialEvent(event);
+    }
+  }
+  static uint32_t lastHeldDrops = 0;
+  if (heldEvents.dropped() != lastHeldDrops) {
+    Serial.print("\n[Warning: ");
+    Serial.print(heldEvents.dropped() - lastHeldDrops);
+    Serial.println(" dial events not shown during the dump]");
+    lastHeldDrops = heldEvents.dropped();
+  }
+  return false;
+}
+
+// Single-key serial commands. Binary mode keeps the port free of text so
+// every byte the host sees belongs to a frame: only the mode switch and a
+// silent stats reset are taken there
+void handleConsole() {
+  while (Serial.available()) {
+    int key = Serial.read();
+    if (binaryTelemetry && key != 't' && key != 'r') {
+      continue;
+    }
+    switch (key) {
+      case 'l':
+        printLatencyStats(false);
+        break;
+      case 'b':
+        printLatencyStats(true);
+        break;
+      case 'o':
+        outputTiming = !outputTiming;
+        Serial.println(outputTiming ? "\n[Output latency timing on - each digit waits for the port]"
+                                    : "\n[Output latency timing off]");
+        break;
+      case 'r':
+        latencyReset();
+        if (!binaryTelemetry) {
+          Serial.println("\n[Latency stats reset]");
+        }
+        break;
+      case 'p':
+        printLastFrame();
+        break;
+      case 'd':
+        dumpTrace();
+        break;
+      case 'v':
+        dialLogLevel = dialLogLevel >= DIAL_LOG_DEBUG ? DIAL_LOG_WARN : dialLogLevel + 1;
+        Serial.print("\n[Log level ");
+        Serial.print(dialLogLevel);
+        Serial.println("]");
+        break;
+      case 't':
+        // Announced from the text side of the switch in both directions
+        if (binaryTelemetry) {
+          binaryTelemetry = false;
+          Serial.println("\n[Text output]");
+        } else {
+          Serial.println("\n[Binary telemetry]");
+          binaryTelemetry = true;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void onSerialReceive() {
+  halNotifyConsumer();  // Wake loop() to handle the command
+}
+
+#if ARDUINO_USB_CDC_ON_BOOT
+void onSerialEvent(void*, esp_event_base_t, int32_t, void*) {
+  onSerialReceive();
+}
+#endif
+
+// Boot banner and configuration, text mode only
+void printBanner(size_t traceCapacity) {
   Serial.println("\n\n========================================");
   Serial.println("    Rotary Dial Test Program");
   Serial.println("========================================");
@@ -132,16 +373,27 @@ void setup() {
   Serial.println("  GPIO 14: ROTARY_SHUNT (off-normal switch)");
   Serial.println();
   Serial.println("Dial a digit and watch the output!");
+  Serial.println("Keys: l = latency stats, b = latency buckets, r = reset stats, o = output latency timing, p = last capture frame, t = text/binary output, v = log level, d = dump edge trace");
   Serial.println("----------------------------------------");
   Serial.println();
   
-  // Configure pins with internal pull-ups
-  pinMode(ROTARY_PULSE_PIN, INPUT_PULLUP);
-  pinMode(ROTARY_SHUNT_PIN, INPUT_PULLUP);
+  if (EDGE_TRACE) {
+    Serial.print("Edge trace: ");
+    Serial.print((unsigned)traceCapacity);
+    Serial.println(" bytes");
+  }
+  
+  Serial.print("Timing: pulse debounce ");
+  Serial.print(dialDecoder.timing().pulseDebounceUs / 1000.0, 1);
+  Serial.print(" ms, shunt debounce ");
+  Serial.print(dialDecoder.timing().dialDebounceUs / 1000.0, 1);
+  Serial.print(" ms, timeout ");
+  Serial.print(dialDecoder.timing().timeoutUs / 1000);
+  Serial.println(" ms");
   
-  // Attach interrupts - try CHANGE to catch both edges
-  attachInterrupt(digitalPinToInterrupt(ROTARY_PULSE_PIN), onPulse, CHANGE);
-  attachInterrupt(digitalPinToInterrupt(ROTARY_SHUNT_PIN), onShuntChange, CHANGE);
+  if (DIAL_BUS_CAPTURE) {
+    Serial.println(busRunning ? "Bus capture: 8 switchboard lines" : "Bus capture: not supported on this chip");
+  }
   
   // Show initial switch states for debugging
   Serial.println("Initial switch states:");
@@ -154,44 +406,89 @@ void setup() {
   Serial.println("Ready! Start dialing...\n");
 }
 
+void setup() {
+  // Native USB (ARDUINO_USB_CDC_ON_BOOT) runs at USB speed whatever the
+  // baud rate; a larger transmit buffer lets trace dumps go out in
+  // bigger pieces
+#if ARDUINO_USB_CDC_ON_BOOT
+  Serial.setTxBufferSize(4096);
+#endif
+  Serial.begin(115200);
+  delay(1000);
+  
+  size_t traceCapacity = 0;
+  if (EDGE_TRACE) {
+    traceCapacity = edgeTraceBegin(EDGE_TRACE_PSRAM_BYTES, EDGE_TRACE_RAM_BYTES);
+  }
+  
+  // Timing profile from NVS if one was flashed (see dial_profile.h)
+  dialDecoder.setTiming(dialProfileLoad());
+  
+  // Configure pins and attach edge interrupts
+  dialInputBegin();
+#if ARDUINO_USB_CDC_ON_BOOT
+  Serial.onEvent(ARDUINO_HW_CDC_RX_EVENT, onSerialEvent);
+#else
+  Serial.onReceive(onSerialReceive);
+#endif
+  
+  // Bus capture wakes the same consumer task, bound by dialInputBegin()
+  if (DIAL_BUS_CAPTURE) {
+    static const uint8_t busPins[BUS_CAPTURE_WIDTH] = DIAL_BUS_PINS;
+    busRunning = busCaptureBegin(busPins, DIAL_BUS_CLOCK_PIN);
+  }
+  
+  // A binary-mode boot stays silent until its first frame
+  if (!binaryTelemetry) {
+    printBanner(traceCapacity);
+  }
+}
+
 void loop() {
-  unsigned long now = millis();
+  // Sleep until an edge is queued, the safety timeout fires or a key arrives
+  halWaitForWork();
   
-  // Handle pulse display (show dots for visual feedback)
-  static int lastDisplayedCount = 0;
-  if (dialing && pulseCount > lastDisplayedCount) {
-    Serial.print(".");
-    Serial.print("[");
-    Serial.print(pulseCount);
-    Serial.print("]");
-    lastDisplayedCount = pulseCount;
+  // Decode queued edges and print the results, then any deferred log.
+  // During a trace dump keys, results and warnings wait for it to finish.
+  if (!edgeTraceDumping()) {
+    handleConsole();
   }
+  dialInputProcess(handleDialEvent);
+  if (busRunning) {
+    drainBus();
+  }
+  if (edgeTraceDumping() && sendTraceDump()) {
+    return;
+  }
+  drainLog();
   
-  // Reset display counter when not dialing
-  if (!dialing) {
-    lastDisplayedCount = 0;
+  // Report ring overflows (edges lost because loop() fell behind)
+  static uint32_t lastDropped = 0;
+  uint32_t dropped = edgeRing.dropped() + captureRing.dropped();
+  if (dropped != lastDropped && binaryTelemetry) {
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    Serial.write(frame, telemetryEncodeDrops(dropped, telemetrySeq++, frame, sizeof(frame)));
+    lastDropped = dropped;
+  } else if (dropped != lastDropped) {
+    Serial.print("\n[Warning: ");
+    Serial.print(dropped - lastDropped);
+    Serial.print(" edge events dropped, ring peak ");
+    Serial.print(edgeRing.highWater());
+    Serial.print("/");
+    Serial.print(EDGE_RING_SIZE);
+    Serial.println("]");
+    lastDropped = dropped;
   }
   
-  // Keep timeout as safety backup (in case shunt switch fails)
-  if (dialing && (now - dialingTimeout) > (DIAL_TIMEOUT_MS * 2)) {  // 3 seconds as backup
-    // Safety timeout reached - something went wrong
-    dialing = false;
-    
-    Serial.println("\n[Safety timeout - dial may be stuck]");
-    
-    if (pulseCount > 0) {
-      // Convert pulse count to digit (10 pulses = 0)
-      int digit = (pulseCount == 10) ? 0 : pulseCount;
-      
-      Serial.println();
-      Serial.print("✓ Digit dialed: ");
-      Serial.print(digit);
-      Serial.print(" (");
-      Serial.print(pulseCount);
-      Serial.println(" pulses)");
-      Serial.println();
+  // Report what shunt auto-detection settled on
+  // (tracked in binary mode too, so a later switch to text does not report
+  // a stale change)
+  static bool lastPulseOnly = dialDecoder.pulseOnly();
+  if (dialDecoder.pulseOnly() != lastPulseOnly) {
+    lastPulseOnly = dialDecoder.pulseOnly();
+    if (!binaryTelemetry) {
+      Serial.println(lastPulseOnly ? "\n[No shunt activity - pulse-only mode, digits end on the pulse gap]"
+                                   : "\n[Shunt detected - digits end when the dial returns to rest]");
     }
   }
-  
-  delay(10);  // Small delay to prevent tight loop
 }
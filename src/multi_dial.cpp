@@ -0,0 +1,100 @@
+/*
+ * Multi-Dial Decoder - see multi_dial.h
+ */
+
+#include "multi_dial.h"
+#include "dial_config.h"
+
+MultiDialDecoder::MultiDialDecoder(int lines)
+  : lines_(lines > MULTI_DIAL_MAX_LINES ? MULTI_DIAL_MAX_LINES : lines) {
+  for (int line = 0; line < MULTI_DIAL_MAX_LINES; line++) {
+    state_[line] = DIAL_STATE_IDLE;
+    pulseCount_[line] = 0;
+    lastPulseState_[line] = 1;   // Same initial levels as DialDecoder
+    lastDialState_[line] = 1;
+    dialingTimeout_[line] = 0;
+    lastPulseDebounce_[line] = 0;
+    lastDialDebounce_[line] = 0;
+  }
+}
+
+void MultiDialDecoder::setInitialLevels(int line, bool pulseState, bool dialState) {
+  lastPulseState_[line] = pulseState;
+  lastDialState_[line] = dialState;
+}
+
+void MultiDialDecoder::setTiming(const DialTiming& timing) {
+  timing_ = timing;
+  safetyTimeoutUs_ = timing.timeoutUs * 2;   // As DialDecoder::setTiming()
+}
+
+DialEvent MultiDialDecoder::step(int line, DialInput input, uint64_t now) {
+  const DialTransition& t = DialDecoder::table.entry[state_[line]][input];
+  state_[line] = t.next;
+  
+  if (t.actions & DIAL_ACTION_RESET) {
+    pulseCount_[line] = 0;
+  }
+  if (t.actions & DIAL_ACTION_COUNT) {
+    pulseCount_[line]++;
+  }
+  if (t.actions & DIAL_ACTION_ARM) {
+    dialingTimeout_[line] = now;
+    uint64_t lineDeadline = now + safetyTimeoutUs_ + 1;
+    if (nextDeadline_ == 0 || lineDeadline < nextDeadline_) {
+      nextDeadline_ = lineDeadline;
+    }
+  }
+  
+  DialEvent event = { t.event, pulseCount_[line], now, (uint8_t)line, 0, 100 };
+  return event;
+}
+
+DialEvent MultiDialDecoder::pulseEdge(int line, uint64_t now, bool currentPulseState) {
+  // Debounce
+  if (now - lastPulseDebounce_[line] < timing_.pulseDebounceUs || currentPulseState == lastPulseState_[line]) {
+    DialEvent none = { DIAL_EVENT_NONE, 0, now, (uint8_t)line, 0, 100 };
+    return none;
+  }
+  
+  lastPulseDebounce_[line] = now;
+  lastPulseState_[line] = currentPulseState;
+  return step(line, currentPulseState ? DIAL_INPUT_PULSE_BREAK : DIAL_INPUT_PULSE_MAKE, now);
+}
+
+DialEvent MultiDialDecoder::shuntEdge(int line, uint64_t now, bool currentDialState) {
+  // Debounce
+  if (now - lastDialDebounce_[line] < timing_.dialDebounceUs || currentDialState == lastDialState_[line]) {
+    DialEvent none = { DIAL_EVENT_NONE, 0, now, (uint8_t)line, 0, 100 };
+    return none;
+  }
+  
+  lastDialDebounce_[line] = now;
+  lastDialState_[line] = currentDialState;
+  return step(line, currentDialState ? DIAL_INPUT_SHUNT_CLOSE : DIAL_INPUT_SHUNT_OPEN, now);
+}
+
+void MultiDialDecoder::poll(uint64_t now, DialEventHandler handler) {
+  if (nextDeadline_ == 0 || now < nextDeadline_) {
+    return;
+  }
+  
+  // At least one deadline is due: scan all lines and find the next one.
+  // Deadlines of lines that finished normally are simply skipped.
+  uint64_t next = 0;
+  for (int line = 0; line < lines_; line++) {
+    if (!isDialingState(state_[line])) {
+      continue;
+    }
+    if (now - dialingTimeout_[line] > safetyTimeoutUs_) {
+      DialEvent event = step(line, DIAL_INPUT_TIMEOUT, now);
+      handler(event);
+      continue;
+    }
+    uint64_t lineDeadline = dialingTimeout_[line] + safetyTimeoutUs_ + 1;
+    if (next == 0 || lineDeadline < next) {
+      next = lineDeadline;
+    }
+  }
+  nextDeadline_ = next;
+}
@@ -0,0 +1,60 @@
+/*
+ * Multi-Dial Decoder
+ *
+ * Decodes many dials (one switchboard line each) with the same transition
+ * table as DialDecoder. Per-line state is laid out struct-of-arrays, so
+ * scanning every line for timeouts touches a few dense arrays instead of
+ * one object per line. Safety timeouts are tracked centrally: poll() is a
+ * single compare until the earliest line deadline is due.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "dial_decoder.h"
+
+#define MULTI_DIAL_MAX_LINES 64
+
+class MultiDialDecoder {
+public:
+  explicit MultiDialDecoder(int lines = MULTI_DIAL_MAX_LINES);
+
+  // Pin levels of a line at startup (see DialDecoder::setInitialLevels)
+  void setInitialLevels(int line, bool pulseState, bool dialState);
+
+  // Debounce windows and safety timeout for every line (see DialTiming)
+  void setTiming(const DialTiming& timing);
+  const DialTiming& timing() const { return timing_; }
+  uint32_t safetyTimeout() const { return safetyTimeoutUs_; }
+
+  // Edge on one line; returns the resulting event (event.line = line)
+  DialEvent pulseEdge(int line, uint64_t now, bool currentPulseState);
+  DialEvent shuntEdge(int line, uint64_t now, bool currentDialState);
+
+  // Report safety timeouts for every line whose deadline has passed
+  void poll(uint64_t now, DialEventHandler handler);
+
+  // Earliest pending safety deadline across all lines, 0 when all idle
+  uint64_t deadline() const { return nextDeadline_; }
+
+  int lines() const { return lines_; }
+  DialState state(int line) const { return (DialState)state_[line]; }
+  int pulseCount(int line) const { return pulseCount_[line]; }
+
+private:
+  DialEvent step(int line, DialInput input, uint64_t now);
+
+  int lines_;
+  uint64_t nextDeadline_ = 0;
+  DialTiming timing_;
+  uint32_t safetyTimeoutUs_ = DIAL_SAFETY_TIMEOUT_US;
+
+  // Per-line state, one array per field
+  uint8_t state_[MULTI_DIAL_MAX_LINES];
+  uint8_t pulseCount_[MULTI_DIAL_MAX_LINES];
+  uint8_t lastPulseState_[MULTI_DIAL_MAX_LINES];
+  uint8_t lastDialState_[MULTI_DIAL_MAX_LINES];
+  uint64_t dialingTimeout_[MULTI_DIAL_MAX_LINES];
+  uint64_t lastPulseDebounce_[MULTI_DIAL_MAX_LINES];
+  uint64_t lastDialDebounce_[MULTI_DIAL_MAX_LINES];
+};
@@ -0,0 +1,48 @@
+/*
+ * Pulse Capture - frame decoding shared by the RMT driver and the host
+ * emulation (see pulse_capture.h)
+ */
+
+#include "pulse_capture.h"
+
+size_t pulseFrameToEdges(const PulseSymbol* symbols, size_t count, uint64_t endTime, uint32_t idleUs,
+                         uint32_t minUs, uint8_t line, EdgeEvent* edges, size_t maxEdges) {
+  // The end marker's level began idleUs before the frame ended; walk the
+  // durations back from there to find when the frame started
+  uint64_t total = 0;
+  size_t halves = 0;
+  for (size_t i = 0; i < 2 * count; i++) {
+    uint32_t ticks = (i & 1) ? symbols[i / 2].duration1 : symbols[i / 2].duration0;
+    if (ticks == 0) {
+      break;
+    }
+    total += (uint64_t)ticks * PULSE_CAPTURE_TICK_US;
+    halves++;
+  }
+  uint64_t markerStart = endTime > idleUs ? endTime - idleUs : 0;
+  uint64_t t = markerStart > total ? markerStart - total : 0;
+  
+  // Keep levels that lasted minUs (and the final one); an edge is reported
+  // when the kept level changes, at the end of the last kept level. The
+  // frame began on an edge, so the line was at the other level before it.
+  size_t written = 0;
+  int kept = count > 0 ? !symbols[0].level0 : -1;
+  uint64_t burst = t;
+  for (size_t i = 0; i <= halves && i < 2 * count; i++) {
+    const PulseSymbol& symbol = symbols[i / 2];
+    int level = (i & 1) ? symbol.level1 : symbol.level0;
+    uint64_t durationUs = (uint64_t)((i & 1) ? symbol.duration1 : symbol.duration0) * PULSE_CAPTURE_TICK_US;
+    bool last = i == halves;
+    
+    if (last || durationUs >= minUs) {
+      if (level != kept && written < maxEdges) {
+        EdgeEvent edge = { burst, line, (uint8_t)level };
+        edges[written++] = edge;
+      }
+      kept = level;
+      burst = t + durationUs;
+    }
+    t += durationUs;
+  }
+  return written;
+}
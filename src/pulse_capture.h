@@ -0,0 +1,49 @@
+/*
+ * Pulse Capture
+ *
+ * RMT capture backend for the pulse contact (DIAL_COUNTER_RMT). The RMT
+ * receiver records how long the line holds each level, in hardware, into
+ * its own memory; a frame ends once the line has been idle for idleUs
+ * (the dial is at rest) and is handed over in one piece. Timing comes
+ * from the RMT clock rather than interrupt entry, so make/break durations
+ * are exact to PULSE_CAPTURE_TICK_US, at one interrupt per frame instead
+ * of one per edge.
+ *
+ * The ESP32 build uses the RMT driver (pulse_capture_rmt.cpp); the native
+ * build produces the same symbol stream from the scripted pins
+ * (host/pulse_capture_emu.cpp). pulseFrameToEdges() is shared by both.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "edge_ring.h"
+
+// One RMT symbol: two level/duration pairs, laid out like rmt_item32_t.
+// A duration of 0 marks the end of the frame.
+struct PulseSymbol {
+  uint32_t duration0 : 15;
+  uint32_t level0 : 1;
+  uint32_t duration1 : 15;
+  uint32_t level1 : 1;
+};
+
+#define PULSE_CAPTURE_TICK_US 3          // RMT clock: 80 MHz APB / 240
+#define PULSE_CAPTURE_MAX_DURATION_US (0x7FFF * PULSE_CAPTURE_TICK_US)
+#define PULSE_CAPTURE_MAX_SYMBOLS 192    // 4 RMT memory blocks of 48 symbols
+
+// Called once per completed frame, from the capture task (ESP32) or from
+// hostSetMicros() (native). endTime is when the idle threshold expired.
+typedef void (*PulseFrameHandler)(const PulseSymbol* symbols, size_t count, uint64_t endTime);
+
+// Start capturing pin; frames end after idleUs without an edge, which
+// must stay below PULSE_CAPTURE_MAX_DURATION_US
+bool pulseCaptureBegin(uint8_t pin, uint32_t idleUs, PulseFrameHandler handler);
+
+// Turn a frame back into timestamped edges for line (EDGE_*), counting
+// back from endTime. A level held for less than minUs is bounce: it is
+// dropped, and the next real level change keeps the time the burst began.
+// Returns the number of edges written.
+size_t pulseFrameToEdges(const PulseSymbol* symbols, size_t count, uint64_t endTime, uint32_t idleUs,
+                         uint32_t minUs, uint8_t line, EdgeEvent* edges, size_t maxEdges);
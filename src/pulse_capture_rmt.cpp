@@ -0,0 +1,56 @@
+/*
+ * Pulse Capture - ESP32 RMT implementation
+ *
+ * The RMT driver's interrupt copies each finished frame into a ring
+ * buffer; a small task takes it from there, stamps the frame end and
+ * passes it to the handler.
+ */
+
+#include "pulse_capture.h"
+#include "hal.h"
+#include <driver/rmt.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/ringbuf.h>
+
+#define CAPTURE_CHANNEL RMT_CHANNEL_4    // First receive channel on the S3
+#define CAPTURE_MEM_BLOCKS 4
+#define CAPTURE_CLOCK_DIV (80 * PULSE_CAPTURE_TICK_US)
+#define CAPTURE_FILTER_CYCLES 255        // ~3.2 us of APB cycles, the hardware maximum
+
+static_assert(CAPTURE_CLOCK_DIV <= 255, "RMT clock divider is 8 bits");
+static_assert(CAPTURE_MEM_BLOCKS * 48 == PULSE_CAPTURE_MAX_SYMBOLS, "Capture memory size mismatch");
+
+static RingbufHandle_t captureBuffer = nullptr;
+static PulseFrameHandler frameHandler = nullptr;
+
+static void captureTask(void*) {
+  for (;;) {
+    size_t bytes = 0;
+    rmt_item32_t* items = (rmt_item32_t*)xRingbufferReceive(captureBuffer, &bytes, portMAX_DELAY);
+    if (!items) {
+      continue;
+    }
+    uint64_t endTime = halMicros();   // Tens of microseconds after the idle threshold
+    frameHandler((const PulseSymbol*)items, bytes / sizeof(rmt_item32_t), endTime);
+    vRingbufferReturnItem(captureBuffer, items);
+  }
+}
+
+bool pulseCaptureBegin(uint8_t pin, uint32_t idleUs, PulseFrameHandler handler) {
+  frameHandler = handler;
+  
+  rmt_config_t config = RMT_DEFAULT_CONFIG_RX((gpio_num_t)pin, CAPTURE_CHANNEL);
+  config.clk_div = CAPTURE_CLOCK_DIV;
+  config.mem_block_num = CAPTURE_MEM_BLOCKS;
+  config.rx_config.filter_en = true;
+  config.rx_config.filter_ticks_thresh = CAPTURE_FILTER_CYCLES;
+  config.rx_config.idle_threshold = idleUs / PULSE_CAPTURE_TICK_US;
+  if (rmt_config(&config) != ESP_OK || rmt_driver_install(CAPTURE_CHANNEL, 4096, 0) != ESP_OK) {
+    return false;
+  }
+  rmt_get_ringbuf_handle(CAPTURE_CHANNEL, &captureBuffer);
+  rmt_rx_start(CAPTURE_CHANNEL, true);
+  
+  return xTaskCreate(captureTask, "dial_capture", 3072, nullptr, configMAX_PRIORITIES - 2, nullptr) == pdPASS;
+}
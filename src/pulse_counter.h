@@ -0,0 +1,23 @@
+/*
+ * Pulse Counter
+ *
+ * Hardware counting backend for the pulse contact (DIAL_COUNTER_PCNT).
+ * Instead of an interrupt per pulse edge (plus bounce), breaks are counted
+ * by the pulse counter peripheral and the decoder only reads the total
+ * when the shunt moves, so a digit costs the CPU two interrupts.
+ *
+ * The ESP32 build drives the PCNT unit (pulse_counter_pcnt.cpp); the
+ * native build emulates the same semantics, including the glitch filter,
+ * on the scripted pins (host/pulse_counter_emu.cpp).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Start counting breaks (pin going HIGH) on pin. Levels that last less than
+// filterNs are ignored. Returns false if the counter could not be set up.
+bool pulseCounterBegin(uint8_t pin, uint32_t filterNs);
+
+int pulseCounterRead();
+void pulseCounterClear();
@@ -0,0 +1,48 @@
+/*
+ * Pulse Counter - ESP32 PCNT implementation
+ */
+
+#include "pulse_counter.h"
+#include <driver/pcnt.h>
+
+#define COUNTER_UNIT PCNT_UNIT_0
+#define APB_CLOCK_MHZ 80
+#define FILTER_MAX_CYCLES 1023   // 10-bit filter threshold
+
+bool pulseCounterBegin(uint8_t pin, uint32_t filterNs) {
+  pcnt_config_t config = {};
+  config.pulse_gpio_num = pin;
+  config.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+  config.lctrl_mode = PCNT_MODE_KEEP;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  config.pos_mode = PCNT_COUNT_INC;   // Rising edge = break, as DialDecoder counts
+  config.neg_mode = PCNT_COUNT_DIS;
+  config.counter_h_lim = INT16_MAX;   // Cleared at the start of every digit
+  config.counter_l_lim = INT16_MIN;
+  config.unit = COUNTER_UNIT;
+  config.channel = PCNT_CHANNEL_0;
+  if (pcnt_unit_config(&config) != ESP_OK) {
+    return false;
+  }
+  
+  // The filter tops out at ~12.8 us: it stops electrical glitches, not
+  // contact bounce (see README)
+  uint32_t cycles = filterNs * APB_CLOCK_MHZ / 1000;
+  pcnt_set_filter_value(COUNTER_UNIT, cycles > FILTER_MAX_CYCLES ? FILTER_MAX_CYCLES : cycles);
+  pcnt_filter_enable(COUNTER_UNIT);
+  
+  pcnt_counter_pause(COUNTER_UNIT);
+  pcnt_counter_clear(COUNTER_UNIT);
+  pcnt_counter_resume(COUNTER_UNIT);
+  return true;
+}
+
+int pulseCounterRead() {
+  int16_t count = 0;
+  pcnt_get_counter_value(COUNTER_UNIT, &count);
+  return count;
+}
+
+void pulseCounterClear() {
+  pcnt_counter_clear(COUNTER_UNIT);
+}
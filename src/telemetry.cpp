@@ -0,0 +1,206 @@
+/*
+ * Telemetry - see telemetry.h
+ */
+
+#include "telemetry.h"
+
+uint16_t telemetryCrc16(const uint8_t* data, size_t length, uint16_t crc) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+size_t telemetryPutVarint(uint64_t value, uint8_t* out, size_t size) {
+  size_t n = 0;
+  do {
+    if (n >= size) {
+      return 0;
+    }
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    out[n++] = value ? (byte | 0x80) : byte;
+  } while (value);
+  return n;
+}
+
+size_t telemetryGetVarint(const uint8_t* data, size_t length, uint64_t* value) {
+  uint64_t result = 0;
+  for (size_t n = 0; n < length && n < 10; n++) {
+    result |= (uint64_t)(data[n] & 0x7F) << (7 * n);
+    if (!(data[n] & 0x80)) {
+      *value = result;
+      return n + 1;
+    }
+  }
+  return 0;
+}
+
+// Append the CRC, COBS-encode payload into out and terminate the frame
+static size_t frame(uint8_t* payload, size_t length, uint8_t* out, size_t size) {
+  uint16_t crc = telemetryCrc16(payload, length);
+  payload[length++] = crc & 0xFF;
+  payload[length++] = crc >> 8;
+  if (size < length + length / 254 + 3) {
+    return 0;
+  }
+  
+  // Leading delimiter: whatever preceded the frame on the wire (boot
+  // messages, text output before a switch to binary) ends here instead of
+  // being glued to the front of this frame
+  out[0] = 0x00;
+  
+  // COBS: each block starts with the distance to the next zero (or to the
+  // end of a 254-byte run), so the encoded frame contains no zeros
+  size_t code = 1;
+  size_t n = 2;
+  for (size_t i = 0; i < length; i++) {
+    if (payload[i] == 0) {
+      out[code] = (uint8_t)(n - code);
+      code = n++;
+    } else {
+      out[n++] = payload[i];
+      if (n - code == 0xFF) {
+        out[code] = 0xFF;
+        code = n++;
+      }
+    }
+  }
+  out[code] = (uint8_t)(n - code);
+  out[n++] = 0x00;
+  return n;
+}
+
+size_t telemetryEncodeEvent(const DialEvent& event, uint8_t seq, uint8_t* out, size_t size) {
+  uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+  size_t n = 0;
+  payload[n++] = TELEMETRY_MSG_EVENT;
+  payload[n++] = seq;
+  payload[n++] = (uint8_t)((event.type & 0x0F) | (event.flags << 4));
+  payload[n++] = event.pulses;
+  payload[n++] = event.confidence;
+  payload[n++] = event.line;
+  n += telemetryPutVarint(event.time, payload + n, sizeof(payload) - 2 - n);
+  return frame(payload, n, out, size);
+}
+
+size_t telemetryEncodeDrops(uint32_t drops, uint8_t seq, uint8_t* out, size_t size) {
+  uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+  size_t n = 0;
+  payload[n++] = TELEMETRY_MSG_DROPS;
+  payload[n++] = seq;
+  n += telemetryPutVarint(drops, payload + n, sizeof(payload) - 2 - n);
+  return frame(payload, n, out, size);
+}
+
+size_t telemetryEncodeLog(const DialLogRecord& record, uint8_t seq, uint8_t* out, size_t size) {
+  uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+  size_t n = 0;
+  payload[n++] = TELEMETRY_MSG_LOG;
+  payload[n++] = seq;
+  payload[n++] = record.id;
+  n += telemetryPutVarint(record.time, payload + n, sizeof(payload) - 2 - n);
+  n += telemetryPutVarint(record.args[0], payload + n, sizeof(payload) - 2 - n);
+  n += telemetryPutVarint(record.args[1], payload + n, sizeof(payload) - 2 - n);
+  return frame(payload, n, out, size);
+}
+
+bool TelemetryDecoder::feed(uint8_t byte, TelemetryMessage& message) {
+  if (byte != 0x00) {
+    if (length_ < sizeof(buffer_)) {
+      buffer_[length_++] = byte;
+    } else {
+      overflow_ = true;
+    }
+    return false;
+  }
+  
+  bool ok = false;
+  if (overflow_) {
+    badFrames_++;
+  } else if (length_ > 0) {
+    ok = decodeFrame(message);
+    if (!ok) {
+      badFrames_++;
+    }
+  }
+  length_ = 0;
+  overflow_ = false;
+  return ok;
+}
+
+bool TelemetryDecoder::decodeFrame(TelemetryMessage& message) {
+  // Undo COBS in place: the output never runs ahead of the input
+  size_t n = 0;
+  size_t i = 0;
+  while (i < length_) {
+    uint8_t code = buffer_[i++];
+    if (code == 0 || i + code - 1 > length_) {
+      return false;
+    }
+    for (uint8_t k = 1; k < code; k++) {
+      buffer_[n++] = buffer_[i++];
+    }
+    if (code != 0xFF && i < length_) {
+      buffer_[n++] = 0x00;
+    }
+  }
+  if (n < 4) {
+    return false;
+  }
+  n -= 2;
+  uint16_t crc = buffer_[n] | (buffer_[n + 1] << 8);
+  if (crc != telemetryCrc16(buffer_, n)) {
+    return false;
+  }
+  
+  const uint8_t* p = buffer_;
+  message = TelemetryMessage();
+  message.type = p[0];
+  message.seq = p[1];
+  uint64_t value = 0;
+  if (message.type == TELEMETRY_MSG_EVENT) {
+    if (n < 7 || !telemetryGetVarint(p + 6, n - 6, &value)) {
+      return false;
+    }
+    message.event.type = (DialEventType)(p[2] & 0x0F);
+    message.event.flags = p[2] >> 4;
+    message.event.pulses = p[3];
+    message.event.confidence = p[4];
+    message.event.line = p[5];
+    message.event.time = value;
+  } else if (message.type == TELEMETRY_MSG_DROPS) {
+    if (!telemetryGetVarint(p + 2, n - 2, &value)) {
+      return false;
+    }
+    message.drops = (uint32_t)value;
+  } else if (message.type == TELEMETRY_MSG_LOG) {
+    size_t used = 3;
+    uint64_t args[2] = { 0, 0 };
+    size_t length = n > used ? telemetryGetVarint(p + used, n - used, &value) : 0;
+    for (int i = 0; length && i < 2; i++) {
+      used += length;
+      length = n > used ? telemetryGetVarint(p + used, n - used, &args[i]) : 0;
+    }
+    if (!length || used + length != n) {
+      return false;
+    }
+    message.log.id = p[2];
+    message.log.time = value;
+    message.log.args[0] = (uint32_t)args[0];
+    message.log.args[1] = (uint32_t)args[1];
+  } else {
+    return false;
+  }
+  
+  if (haveSeq_) {
+    lost_ += (uint8_t)(message.seq - nextSeq_);
+  }
+  haveSeq_ = true;
+  nextSeq_ = message.seq + 1;
+  frames_++;
+  return true;
+}
@@ -0,0 +1,88 @@
+/*
+ * Telemetry
+ *
+ * Compact binary event output for a supervising host, as an alternative
+ * to the readable Serial prints (DIAL_TELEMETRY in dial_config.h).
+ *
+ * Each message is a small payload followed by a CRC-16/CCITT-FALSE of the
+ * payload (little endian), COBS-encoded and enclosed in 0x00 bytes. A
+ * receiver can start listening at any point: it drops bytes up to the
+ * next 0x00, and a frame with a bad CRC is discarded as a whole. The
+ * leading 0x00 cuts off anything written before the frame, so a frame
+ * sent right after text output still decodes; the empty frame between
+ * two back-to-back delimiters is skipped.
+ *
+ * Payload layout (varint = unsigned LEB128):
+ *
+ *   TELEMETRY_MSG_EVENT  type, seq, event type | flags << 4, pulses,
+ *                        confidence, line, varint time (us since boot)
+ *   TELEMETRY_MSG_DROPS  type, seq, varint edges dropped since boot
+ *   TELEMETRY_MSG_LOG    type, seq, log ID, varint time, varint arg 0,
+ *                        varint arg 1 (a dial_log.h record, unformatted)
+ *
+ * seq counts messages modulo 256, so a gap tells the receiver how many it
+ * lost. A digit costs one frame of about 15 bytes where the text output
+ * spends around 100 bytes on it.
+ *
+ * Encoding and decoding are plain functions over byte buffers, shared by
+ * the firmware and the host tools (program telemetry).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dial_decoder.h"
+#include "dial_log.h"
+
+#define TELEMETRY_MSG_EVENT 0x01
+#define TELEMETRY_MSG_DROPS 0x02
+#define TELEMETRY_MSG_LOG 0x03
+
+#define TELEMETRY_MAX_PAYLOAD 32
+#define TELEMETRY_MAX_FRAME (TELEMETRY_MAX_PAYLOAD + 2 + TELEMETRY_MAX_PAYLOAD / 254 + 3)
+
+struct TelemetryMessage {
+  uint8_t type;     // TELEMETRY_MSG_*
+  uint8_t seq;
+  DialEvent event;  // TELEMETRY_MSG_EVENT
+  uint32_t drops;   // TELEMETRY_MSG_DROPS
+  DialLogRecord log;  // TELEMETRY_MSG_LOG
+};
+
+// CRC-16/CCITT-FALSE; pass the previous result as crc to continue over
+// several buffers
+uint16_t telemetryCrc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF);
+
+// Unsigned LEB128; returns bytes written / consumed (0: out of room or truncated)
+size_t telemetryPutVarint(uint64_t value, uint8_t* out, size_t size);
+size_t telemetryGetVarint(const uint8_t* data, size_t length, uint64_t* value);
+
+// Wire frame for a message: payload + CRC, COBS-encoded, between 0x00s.
+// Returns the frame length, 0 if it does not fit in size.
+size_t telemetryEncodeEvent(const DialEvent& event, uint8_t seq, uint8_t* out, size_t size);
+size_t telemetryEncodeDrops(uint32_t drops, uint8_t seq, uint8_t* out, size_t size);
+size_t telemetryEncodeLog(const DialLogRecord& record, uint8_t seq, uint8_t* out, size_t size);
+
+// Byte-at-a-time receiver. feed() returns true when a valid frame ended
+// with this byte and filled message.
+class TelemetryDecoder {
+public:
+  bool feed(uint8_t byte, TelemetryMessage& message);
+
+  uint32_t frames() const { return frames_; }
+  uint32_t badFrames() const { return badFrames_; }   // CRC or layout errors, overlong frames
+  uint32_t lost() const { return lost_; }             // Messages missing from the seq sequence
+
+private:
+  bool decodeFrame(TelemetryMessage& message);
+
+  uint8_t buffer_[TELEMETRY_MAX_FRAME];
+  size_t length_ = 0;
+  bool overflow_ = false;
+  bool haveSeq_ = false;
+  uint8_t nextSeq_ = 0;
+  uint32_t frames_ = 0;
+  uint32_t badFrames_ = 0;
+  uint32_t lost_ = 0;
+};